@@ -1,6 +1,7 @@
 // Copyright (c) Improbable Worlds Ltd, All Rights Reserved
 
 #include "FirstPersonTraceProvider.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "GDKLogging.h"
 
 UFirstPersonTraceProvider::UFirstPersonTraceProvider()
@@ -11,7 +12,7 @@ UFirstPersonTraceProvider::UFirstPersonTraceProvider()
 void UFirstPersonTraceProvider::BeginPlay()
 {
 	Super::BeginPlay();
-	FirstPersonCamera = Cast<UCameraComponent>(GetOwner()->GetComponentByClass(UCameraComponent::StaticClass()));
+	FirstPersonCamera = FComponentRegistry::Get<UCameraComponent>(GetOwner());
 
 	if (!FirstPersonCamera)
 	{
@@ -2,13 +2,37 @@
 
 #include "Components/GDKMovementComponent.h"
 
+#include "Characters/ServerMoveScheduler.h"
+#include "EngineUtils.h"
 #include "GameFramework/Character.h"
 #include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
 #include "UnrealNetwork.h"
 #include "GDKLogging.h"
 
 // Use the first custom movement flag slot in the character for sprinting.
 static const FSavedMove_Character::CompressedFlags FLAG_WantsToSprint = FSavedMove_GDKMovement::FLAG_Custom_0;
+// And the second for aiming, which slows the character down.
+static const FSavedMove_Character::CompressedFlags FLAG_WantsToAim = FSavedMove_GDKMovement::FLAG_Custom_1;
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkSpeedModeCommand(
+	TEXT("GDK.BenchmarkSpeedMode"),
+	TEXT("Compares the speed queries of N move steps with and without the cached speed mode. Usage: GDK.BenchmarkSpeedMode [N]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UGDKMovementComponent::RunBenchmark));
+
+namespace
+{
+	enum ESpeedModeKeyBits : uint8
+	{
+		SpeedModeKey_Crouching = 1 << 0,
+		SpeedModeKey_Aiming = 1 << 1,
+		SpeedModeKey_Busy = 1 << 2,
+		SpeedModeKey_CanSprint = 1 << 3,
+		SpeedModeKey_WantsToSprint = 1 << 4,
+		SpeedModeKey_MovingForward = 1 << 5,
+		SpeedModeKey_Invalid = 0xFF
+	};
+}
 
 UGDKMovementComponent::UGDKMovementComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -23,6 +47,12 @@ UGDKMovementComponent::UGDKMovementComponent(const FObjectInitializer& ObjectIni
 	, SprintAcceleration(3400)
 	, SprintDirectionTolerance(0.1f)
 	, JogAcceleration(1800)
+	, bBatchServerMoves(false)
+	, bProcessingQueuedServerMoves(false)
+	, ServerMoveScheduler(nullptr)
+	, bMovingForwardThisMove(false)
+	, CachedSpeedModeKey(SpeedModeKey_Invalid)
+	, CachedSpeedMode(EGDKSpeedMode::Jogging)
 {
 	MaxWalkSpeed = 250;
 	MaxWalkSpeedCrouched = 125;
@@ -36,9 +66,10 @@ void UGDKMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickT
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	if (IsSprinting() != bWasSprintingLastFrame) {
-		bWasSprintingLastFrame = IsSprinting();
-		SprintingUpdated.Broadcast(IsSprinting());
+	const bool bIsSprinting = IsSprinting();
+	if (bIsSprinting != bWasSprintingLastFrame) {
+		bWasSprintingLastFrame = bIsSprinting;
+		SprintingUpdated.Broadcast(bIsSprinting);
 	}
 }
 
@@ -46,7 +77,7 @@ void UGDKMovementComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UGDKMovementComponent, bIsAiming);
+	DOREPLIFETIME_CONDITION(UGDKMovementComponent, bIsAiming, COND_SimulatedOnly);
 }
 
 void UGDKMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
@@ -55,6 +86,17 @@ void UGDKMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
 
 	// Extract saved state from Flags and apply it to our local variables.
 	bWantsToSprint = (Flags & FLAG_WantsToSprint) != 0;
+
+	const bool bWantsToAim = (Flags & FLAG_WantsToAim) != 0;
+	if (bWantsToAim != bIsAiming)
+	{
+		bIsAiming = bWantsToAim;
+		// Replaying moves after a correction only revisits states the owner has already been through.
+		if (CharacterOwner == nullptr || !CharacterOwner->bClientUpdating)
+		{
+			OnAimingUpdated.Broadcast(bIsAiming);
+		}
+	}
 }
 
 class FNetworkPredictionData_Client* UGDKMovementComponent::GetPredictionData_Client() const
@@ -74,6 +116,107 @@ class FNetworkPredictionData_Client* UGDKMovementComponent::GetPredictionData_Cl
 	return ClientPredictionData;
 }
 
+void UGDKMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	// Every move step, including client moves replayed on the server, comes through here once.
+	bMovingForwardThisMove = IsMovingForward();
+}
+
+void UGDKMovementComponent::SimulateMovement(float DeltaTime)
+{
+	// Simulated proxies don't update their character state before moving.
+	bMovingForwardThisMove = IsMovingForward();
+
+	Super::SimulateMovement(DeltaTime);
+}
+
+void UGDKMovementComponent::ServerMove_Implementation(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags,
+	uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	FQueuedServerMove* Move = QueueServerMove();
+	if (Move == nullptr)
+	{
+		Super::ServerMove_Implementation(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+		return;
+	}
+
+	Move->bOldMove = false;
+	Move->TimeStamp = TimeStamp;
+	Move->Accel = InAccel;
+	Move->ClientLoc = ClientLoc;
+	Move->CompressedMoveFlags = CompressedMoveFlags;
+	Move->ClientRoll = ClientRoll;
+	Move->View = View;
+	Move->ClientMovementBase = ClientMovementBase;
+	Move->ClientBaseBoneName = ClientBaseBoneName;
+	Move->ClientMovementMode = ClientMovementMode;
+}
+
+void UGDKMovementComponent::ServerMoveOld_Implementation(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags)
+{
+	// Old moves are queued too, so they are still processed before the moves that arrived with them.
+	FQueuedServerMove* Move = QueueServerMove();
+	if (Move == nullptr)
+	{
+		Super::ServerMoveOld_Implementation(OldTimeStamp, OldAccel, OldMoveFlags);
+		return;
+	}
+
+	Move->bOldMove = true;
+	Move->TimeStamp = OldTimeStamp;
+	Move->Accel = OldAccel;
+	Move->CompressedMoveFlags = OldMoveFlags;
+}
+
+UGDKMovementComponent::FQueuedServerMove* UGDKMovementComponent::QueueServerMove()
+{
+	if (!bBatchServerMoves || bProcessingQueuedServerMoves)
+	{
+		return nullptr;
+	}
+
+	if (ServerMoveScheduler == nullptr)
+	{
+		ServerMoveScheduler = AGDKWorldManager::Get<AServerMoveScheduler>(this);
+		if (ServerMoveScheduler == nullptr)
+		{
+			return nullptr;
+		}
+		// So the component's own tick sees this frame's moves.
+		PrimaryComponentTick.AddPrerequisite(ServerMoveScheduler, ServerMoveScheduler->PrimaryActorTick);
+	}
+
+	if (QueuedServerMoves.Num() == 0)
+	{
+		ServerMoveScheduler->Enqueue(this);
+	}
+	return &QueuedServerMoves.AddDefaulted_GetRef();
+}
+
+int32 UGDKMovementComponent::ProcessQueuedServerMoves()
+{
+	bProcessingQueuedServerMoves = true;
+	for (const FQueuedServerMove& Move : QueuedServerMoves)
+	{
+		if (Move.bOldMove)
+		{
+			Super::ServerMoveOld_Implementation(Move.TimeStamp, Move.Accel, Move.CompressedMoveFlags);
+		}
+		else
+		{
+			Super::ServerMove_Implementation(Move.TimeStamp, Move.Accel, Move.ClientLoc, Move.CompressedMoveFlags, Move.ClientRoll, Move.View,
+				Move.ClientMovementBase.Get(), Move.ClientBaseBoneName, Move.ClientMovementMode);
+		}
+	}
+	bProcessingQueuedServerMoves = false;
+
+	const int32 NumMoves = QueuedServerMoves.Num();
+	QueuedServerMoves.Reset();
+	return NumMoves;
+}
+
 void UGDKMovementComponent::SetSprintEnabled(bool bSprintEnabled)
 {
 	bCanSprint = bSprintEnabled;
@@ -86,13 +229,49 @@ void UGDKMovementComponent::SetWantsToSprint(bool bSprinting)
 
 bool UGDKMovementComponent::IsSprinting() const
 {
-	return
-		static_cast<bool>(bCanSprint)
-		&& static_cast<bool>(bWantsToSprint)
-		&& IsMovingForward()
-		&& !IsCrouching()
-		&& !IsAiming()
-		&& !IsBusy();
+	return GetSpeedMode() == EGDKSpeedMode::Sprinting;
+}
+
+EGDKSpeedMode UGDKMovementComponent::GetSpeedMode() const
+{
+	const uint8 Key = GetSpeedModeKey(bMovingForwardThisMove);
+	if (Key != CachedSpeedModeKey)
+	{
+		CachedSpeedModeKey = Key;
+		CachedSpeedMode = ComputeSpeedMode(Key);
+	}
+	return CachedSpeedMode;
+}
+
+uint8 UGDKMovementComponent::GetSpeedModeKey(bool bMovingForward) const
+{
+	uint8 Key = 0;
+	Key |= IsCrouching() ? SpeedModeKey_Crouching : 0;
+	Key |= bIsAiming ? SpeedModeKey_Aiming : 0;
+	Key |= bIsBusy ? SpeedModeKey_Busy : 0;
+	Key |= bCanSprint ? SpeedModeKey_CanSprint : 0;
+	Key |= bWantsToSprint ? SpeedModeKey_WantsToSprint : 0;
+	Key |= bMovingForward ? SpeedModeKey_MovingForward : 0;
+	return Key;
+}
+
+EGDKSpeedMode UGDKMovementComponent::ComputeSpeedMode(uint8 Key)
+{
+	if (Key & SpeedModeKey_Crouching)
+	{
+		return EGDKSpeedMode::Crouching;
+	}
+	else if (Key & SpeedModeKey_Aiming)
+	{
+		return EGDKSpeedMode::Aiming;
+	}
+
+	const uint8 SprintKey = SpeedModeKey_CanSprint | SpeedModeKey_WantsToSprint | SpeedModeKey_MovingForward;
+	if ((Key & (SprintKey | SpeedModeKey_Busy)) == SprintKey)
+	{
+		return EGDKSpeedMode::Sprinting;
+	}
+	return EGDKSpeedMode::Jogging;
 }
 
 bool UGDKMovementComponent::IsAiming() const
@@ -102,36 +281,31 @@ bool UGDKMovementComponent::IsAiming() const
 
 float UGDKMovementComponent::GetMaxSpeed() const
 {
-	if (IsCrouching())
+	switch (GetSpeedMode())
 	{
+	case EGDKSpeedMode::Crouching:
 		return MaxWalkSpeedCrouched;
-	}
-	else if (IsAiming())
-	{
+	case EGDKSpeedMode::Aiming:
 		return MaxWalkSpeed;
-	}
-	else if (IsSprinting())
-	{
+	case EGDKSpeedMode::Sprinting:
 		return MaxSprintSpeed;
+	default:
+		return MaxJogSpeed;
 	}
-	return MaxJogSpeed;
 }
 
 float UGDKMovementComponent::GetMaxAcceleration() const
 {
-	if (IsCrouching())
-	{
-		return MaxAcceleration;
-	}
-	else if (IsAiming())
+	switch (GetSpeedMode())
 	{
+	case EGDKSpeedMode::Crouching:
+	case EGDKSpeedMode::Aiming:
 		return MaxAcceleration;
-	}
-	else if (IsSprinting())
-	{
+	case EGDKSpeedMode::Sprinting:
 		return SprintAcceleration;
+	default:
+		return JogAcceleration;
 	}
-	return JogAcceleration;
 }
 
 bool UGDKMovementComponent::IsMovingForward() const
@@ -164,6 +338,7 @@ void FSavedMove_GDKMovement::Clear()
 {
 	Super::Clear();
 	bSavedWantsToSprint = false;
+	bSavedIsAiming = false;
 }
 
 uint8 FSavedMove_GDKMovement::GetCompressedFlags() const
@@ -173,12 +348,17 @@ uint8 FSavedMove_GDKMovement::GetCompressedFlags() const
 	{
 		Result |= FLAG_WantsToSprint;
 	}
+	if (bSavedIsAiming)
+	{
+		Result |= FLAG_WantsToAim;
+	}
 	return Result;
 }
 
 bool FSavedMove_GDKMovement::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InPawn, float MaxDelta) const
 {
-	if (bSavedWantsToSprint != ((FSavedMove_GDKMovement*)&NewMove)->bSavedWantsToSprint)
+	const FSavedMove_GDKMovement* NewGDKMove = static_cast<const FSavedMove_GDKMovement*>(NewMove.Get());
+	if (bSavedWantsToSprint != NewGDKMove->bSavedWantsToSprint || bSavedIsAiming != NewGDKMove->bSavedIsAiming)
 	{
 		return false;
 	}
@@ -193,6 +373,7 @@ void FSavedMove_GDKMovement::SetMoveFor(ACharacter* Character, float InDeltaTime
 	if (CharacterMovement)
 	{
 		bSavedWantsToSprint = CharacterMovement->bWantsToSprint;
+		bSavedIsAiming = CharacterMovement->bIsAiming;
 	}
 }
 
@@ -215,27 +396,63 @@ bool UGDKMovementComponent::CanCrouchInCurrentState() const
 	return !IsFalling() && IsMovingOnGround() && UpdatedComponent && !UpdatedComponent->IsSimulatingPhysics();
 }
 
-bool UGDKMovementComponent::ServerSetAiming_Validate(bool NewValue)
+void UGDKMovementComponent::SetAiming(bool NewValue)
 {
-	return true;
+	bIsAiming = NewValue;
+	OnAimingUpdated.Broadcast(bIsAiming);
 }
 
-void UGDKMovementComponent::ServerSetAiming_Implementation(bool NewValue)
+void UGDKMovementComponent::OnRep_IsAiming()
 {
-	bIsAiming = NewValue;
+	OnAimingUpdated.Broadcast(bIsAiming);
 }
 
-void UGDKMovementComponent::SetAiming(bool NewValue)
+void UGDKMovementComponent::RunBenchmark(const TArray<FString>& Args, UWorld* World)
 {
-	bIsAiming = NewValue;
-	if (GetOwnerRole() != ROLE_SimulatedProxy)
+	UGDKMovementComponent* Movement = nullptr;
+	for (TActorIterator<ACharacter> It(World); It; ++It)
 	{
-		ServerSetAiming(NewValue);
+		Movement = Cast<UGDKMovementComponent>(It->GetCharacterMovement());
+		if (Movement != nullptr)
+		{
+			break;
+		}
+	}
+	if (Movement == nullptr)
+	{
+		UE_LOG(LogGDK, Warning, TEXT("GDK.BenchmarkSpeedMode: no character with a GDK movement component in this world."));
+		return;
 	}
-	OnAimingUpdated.Broadcast(bIsAiming);
-}
 
-void UGDKMovementComponent::OnRep_IsAiming()
-{
-	OnAimingUpdated.Broadcast(bIsAiming);
+	const int32 NumMoves = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+
+	// A walking move step asks for the max speed and acceleration twice each, and the tick asks whether the character
+	// is sprinting. Without the cache, every query did the direction check.
+	double StartTime = FPlatformTime::Seconds();
+	int32 Total = 0;
+	for (int32 Index = 0; Index < NumMoves; ++Index)
+	{
+		for (int32 Query = 0; Query < 5; ++Query)
+		{
+			Total += static_cast<int32>(ComputeSpeedMode(Movement->GetSpeedModeKey(Movement->IsMovingForward())));
+		}
+	}
+	const double UncachedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	float CachedTotal = 0.0f;
+	for (int32 Index = 0; Index < NumMoves; ++Index)
+	{
+		Movement->bMovingForwardThisMove = Movement->IsMovingForward();
+		CachedTotal += Movement->GetMaxSpeed();
+		CachedTotal += Movement->GetMaxAcceleration();
+		CachedTotal += Movement->GetMaxSpeed();
+		CachedTotal += Movement->GetMaxAcceleration();
+		CachedTotal += Movement->IsSprinting() ? 1.0f : 0.0f;
+	}
+	const double CachedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogGDK, Display, TEXT("GDK.BenchmarkSpeedMode: %d move steps (%d, %.0f)."), NumMoves, Total, CachedTotal);
+	UE_LOG(LogGDK, Display, TEXT("  Direction check per query: %8.1f ns per move step"), UncachedSeconds * 1.e9 / NumMoves);
+	UE_LOG(LogGDK, Display, TEXT("  Cached speed mode:         %8.1f ns per move step"), CachedSeconds * 1.e9 / NumMoves);
 }
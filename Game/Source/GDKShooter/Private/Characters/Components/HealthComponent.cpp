@@ -1,15 +1,26 @@
 // Copyright (c) Improbable Worlds Ltd, All Rights Reserved
 
 #include "HealthComponent.h"
+#include "Characters/RegenerationScheduler.h"
 #include "Components/ControllerEventsComponent.h"
 #include "Components/ScorePublisher.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "GameFramework/Pawn.h"
 #include "TeamComponent.h"
 #include "UnrealNetwork.h"
 
+namespace
+{
+	// Hits whose directions from the owner are within this angle are merged into one damage source. Cosine of 30 degrees.
+	const float DamageSourceMergeCosine = 0.866f;
+}
+
 UHealthComponent::UHealthComponent()
 {
+	// Ticks only on frames in which damage was taken, after everything else, to send it in one go.
 	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
 
 	bReplicates = true;
 
@@ -17,6 +28,10 @@ UHealthComponent::UHealthComponent()
 	CurrentHealth = MaxHealth;
 	MaxArmour = 100.f;
 	CurrentArmour = 0.f;
+	MaxDamageSources = 4;
+	LargestPendingHit = 0.f;
+	RegenerationScheduler = nullptr;
+	RegenerationIndex = INDEX_NONE;
 }
 
 
@@ -44,20 +59,18 @@ void UHealthComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
-	if (GetOwner()->GetWorldTimerManager().IsTimerActive(HealthRegenerationHandle))
-	{
-		GetOwner()->GetWorldTimerManager().ClearTimer(HealthRegenerationHandle);
-	}
-
-	if (GetOwner()->GetWorldTimerManager().IsTimerActive(ArmourRegenerationHandle))
+	if (RegenerationIndex != INDEX_NONE)
 	{
-		GetOwner()->GetWorldTimerManager().ClearTimer(ArmourRegenerationHandle);
+		if (ARegenerationScheduler* Scheduler = AGDKWorldManager::Find<ARegenerationScheduler>(this))
+		{
+			Scheduler->Unregister(this);
+		}
 	}
 }
 
 void UHealthComponent::TakeDamage(float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	if (UTeamComponent* Team = Cast<UTeamComponent>(GetOwner()->GetComponentByClass(UTeamComponent::StaticClass())))
+	if (UTeamComponent* Team = FComponentRegistry::Get<UTeamComponent>(GetOwner()))
 	{
 		if (EventInstigator && !Team->CanDamageActor(EventInstigator->GetPawn()))
 		{
@@ -112,7 +125,7 @@ void UHealthComponent::TakeDamage(float Damage, const FDamageEvent& DamageEvent,
 		Impact = GetOwner()->GetActorLocation();
 	}
 
-	MulticastDamageTaken(Damage, Source, Impact, InstigatorPlayerId, InstigatorTeamId);
+	AccumulateDamage(Damage, Source, Impact, InstigatorPlayerId, InstigatorTeamId);
 
 	if (!bWasDead && bIsDead)
 	{
@@ -122,14 +135,14 @@ void UHealthComponent::TakeDamage(float Damage, const FDamageEvent& DamageEvent,
 		{
 			if (AController* Controller = OwnerAsPawn->GetController())
 			{
-				if (UControllerEventsComponent* ControllerEvents = Cast<UControllerEventsComponent>(Controller->GetComponentByClass(UControllerEventsComponent::StaticClass())))
+				if (UControllerEventsComponent* ControllerEvents = FComponentRegistry::Get<UControllerEventsComponent>(Controller))
 				{
 					ControllerEvents->Death(EventInstigator);
 				}
 
 				if (EventInstigator != nullptr)
 				{
-					if (UControllerEventsComponent* ControllerEvents = Cast<UControllerEventsComponent>(EventInstigator->GetComponentByClass(UControllerEventsComponent::StaticClass())))
+					if (UControllerEventsComponent* ControllerEvents = FComponentRegistry::Get<UControllerEventsComponent>(EventInstigator))
 					{
 						ControllerEvents->Kill(Controller);
 					}
@@ -139,23 +152,15 @@ void UHealthComponent::TakeDamage(float Damage, const FDamageEvent& DamageEvent,
 	}
 
 
-	if(!bIsDead)
+	if (!bIsDead && (HealthRegenInterval > 0 || ArmourRegenInterval > 0))
 	{
-		if (GetOwner()->GetWorldTimerManager().IsTimerActive(HealthRegenerationHandle))
-		{
-			GetOwner()->GetWorldTimerManager().ClearTimer(HealthRegenerationHandle);
-		}
-		if (GetOwner()->GetWorldTimerManager().IsTimerActive(ArmourRegenerationHandle))
+		if (RegenerationScheduler == nullptr)
 		{
-			GetOwner()->GetWorldTimerManager().ClearTimer(ArmourRegenerationHandle);
+			RegenerationScheduler = AGDKWorldManager::Get<ARegenerationScheduler>(this);
 		}
-		if (HealthRegenInterval > 0)
+		if (RegenerationScheduler != nullptr)
 		{
-			GetOwner()->GetWorldTimerManager().SetTimer(HealthRegenerationHandle, this, &UHealthComponent::RegenerateHealth, HealthRegenInterval, true, HealthRegenCooldown);
-		}
-		if (ArmourRegenInterval > 0)
-		{
-			GetOwner()->GetWorldTimerManager().SetTimer(ArmourRegenerationHandle, this, &UHealthComponent::RegenerateArmour, ArmourRegenInterval, true, ArmourRegenCooldown);
+			RegenerationScheduler->DelayRegeneration(this);
 		}
 	}
 }
@@ -214,7 +219,66 @@ void UHealthComponent::OnRep_CurrentHealth()
 	}
 }
 
-void UHealthComponent::MulticastDamageTaken_Implementation(float Value, FVector Source, FVector Impact, int32 PlayerId, FGenericTeamId TeamId)
+void UHealthComponent::AccumulateDamage(float Damage, const FVector& Source, const FVector& Impact, int32 InstigatorPlayerId, FGenericTeamId InstigatorTeamId)
 {
-	DamageTaken.Broadcast(Value, Source, Impact, PlayerId, TeamId);
+	if (PendingDamage.Sources.Num() == 0)
+	{
+		LargestPendingHit = 0.f;
+		SetComponentTickEnabled(true);
+	}
+
+	if (Damage >= LargestPendingHit)
+	{
+		LargestPendingHit = Damage;
+		PendingDamage.InstigatorPlayerId = InstigatorPlayerId;
+		PendingDamage.InstigatorTeamId = InstigatorTeamId;
+	}
+
+	// Merge with the source in the most similar direction, if it's close enough or there's no room for another.
+	const FVector Location = GetOwner()->GetActorLocation();
+	const FVector Direction = (Source - Location).GetSafeNormal();
+	int32 ClosestIndex = INDEX_NONE;
+	float ClosestCosine = -2.f;
+	for (int32 Index = 0; Index < PendingDamage.Sources.Num(); ++Index)
+	{
+		const float Cosine = (PendingDamage.Sources[Index].Source - Location).GetSafeNormal() | Direction;
+		if (Cosine > ClosestCosine)
+		{
+			ClosestCosine = Cosine;
+			ClosestIndex = Index;
+		}
+	}
+
+	if (ClosestIndex != INDEX_NONE && (ClosestCosine >= DamageSourceMergeCosine || PendingDamage.Sources.Num() >= MaxDamageSources))
+	{
+		FDamageSource& Merged = PendingDamage.Sources[ClosestIndex];
+		Merged.Damage += Damage;
+		Merged.Impact = Impact;
+		return;
+	}
+
+	FDamageSource& Added = PendingDamage.Sources.AddDefaulted_GetRef();
+	Added.Damage = Damage;
+	Added.Source = Source;
+	Added.Impact = Impact;
+}
+
+void UHealthComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (PendingDamage.Sources.Num() > 0)
+	{
+		MulticastDamageTaken(PendingDamage);
+		PendingDamage.Sources.Reset();
+	}
+	SetComponentTickEnabled(false);
+}
+
+void UHealthComponent::MulticastDamageTaken_Implementation(const FDamageSummary& Summary)
+{
+	for (const FDamageSource& Source : Summary.Sources)
+	{
+		DamageTaken.Broadcast(Source.Damage, Source.Source, Source.Impact, Summary.InstigatorPlayerId, Summary.InstigatorTeamId);
+	}
 }
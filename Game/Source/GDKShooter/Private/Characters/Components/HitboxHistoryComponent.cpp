@@ -0,0 +1,197 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "HitboxHistoryComponent.h"
+#include "Characters/Components/GDKMovementComponent.h"
+#include "Characters/Components/ShootingComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/ComponentRegistry.h"
+#include "GameFramework/Pawn.h"
+#include "GDKStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("RecordHitboxSnapshot"), STAT_GDKRecordHitboxSnapshot, STATGROUP_GDKShooter);
+
+UHitboxHistoryComponent::UHitboxHistoryComponent()
+	: MaxRewindTime(0.5f)
+	, SnapshotInterval(1.0f / 30.0f)
+	, ShootingComponent(nullptr)
+	, MovementComponent(nullptr)
+	, NewestIndex(0)
+	, NumSnapshots(0)
+	, NextSnapshotTime(0.0f)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// Record after movement, so snapshots reflect the pose clients will be sent this frame.
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UHitboxHistoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetNetMode() == NM_Client || !GetOwner()->HasAuthority())
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	StartRecording();
+}
+
+void UHitboxHistoryComponent::OnAuthorityGained()
+{
+	if (GetNetMode() != NM_Client && HasBegunPlay())
+	{
+		StartRecording();
+	}
+}
+
+void UHitboxHistoryComponent::OnAuthorityLost()
+{
+	SetComponentTickEnabled(false);
+	NumSnapshots = 0;
+}
+
+void UHitboxHistoryComponent::StartRecording()
+{
+	// Enough slots to span MaxRewindTime, one more because the newest snapshot can be up to an interval old,
+	// and one more so that interpolating at the very end of the rewind window still has an older neighbour.
+	const int32 Capacity = FMath::CeilToInt(MaxRewindTime / SnapshotInterval) + 2;
+	Snapshots.SetNumZeroed(Capacity);
+
+	ShootingComponent = Cast<APawn>(GetOwner()) != nullptr ? FComponentRegistry::Get<UShootingComponent>(GetOwner()) : nullptr;
+	MovementComponent = FComponentRegistry::Get<UGDKMovementComponent>(GetOwner());
+	Views.SetNumZeroed(ShootingComponent != nullptr ? Capacity : 0);
+
+	NewestIndex = 0;
+	NumSnapshots = 0;
+	NextSnapshotTime = GetWorld()->GetTimeSeconds();
+	SetComponentTickEnabled(true);
+}
+
+void UHitboxHistoryComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (Now < NextSnapshotTime || Snapshots.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_GDKRecordHitboxSnapshot);
+
+	// After a long hitch only the last MaxRewindTime of grid points can ever be looked up, so skip the rest.
+	if (Now - NextSnapshotTime > MaxRewindTime)
+	{
+		NextSnapshotTime += FMath::FloorToFloat((Now - NextSnapshotTime - MaxRewindTime) / SnapshotInterval) * SnapshotInterval;
+	}
+
+	const FBox Hitbox = GetOwner()->GetComponentsBoundingBox();
+	FViewSnapshot View;
+	GetCurrentView(View);
+	while (NextSnapshotTime <= Now)
+	{
+		RecordSnapshot(NextSnapshotTime, Hitbox, View);
+		NextSnapshotTime += SnapshotInterval;
+	}
+}
+
+void UHitboxHistoryComponent::RecordSnapshot(float Timestamp, const FBox& Hitbox, const FViewSnapshot& View)
+{
+	NewestIndex = (NewestIndex + 1) % Snapshots.Num();
+	NumSnapshots = FMath::Min(NumSnapshots + 1, Snapshots.Num());
+
+	FHitboxSnapshot& Snapshot = Snapshots[NewestIndex];
+	Snapshot.Timestamp = Timestamp;
+	Snapshot.Center = Hitbox.GetCenter();
+	Snapshot.Extent = Hitbox.GetExtent();
+
+	if (Views.Num() > 0)
+	{
+		Views[NewestIndex] = View;
+		Views[NewestIndex].Timestamp = Timestamp;
+	}
+}
+
+bool UHitboxHistoryComponent::GetCurrentView(FViewSnapshot& OutView) const
+{
+	if (ShootingComponent == nullptr)
+	{
+		return false;
+	}
+
+	OutView.Timestamp = GetWorld()->GetTimeSeconds();
+	OutView.ViewLocation = ShootingComponent->GetLineTraceStart();
+	OutView.AimRotation = CastChecked<APawn>(GetOwner())->GetBaseAimRotation();
+	OutView.bAiming = MovementComponent != nullptr && MovementComponent->IsAiming();
+	OutView.bCrouching = MovementComponent != nullptr && MovementComponent->IsCrouching();
+	return true;
+}
+
+void UHitboxHistoryComponent::FindSnapshotsAtTime(float Time, int32& OutNewerSteps, int32& OutOlderSteps, float& OutAlpha) const
+{
+	const FHitboxSnapshot& Newest = Snapshots[NewestIndex];
+
+	// Snapshots are evenly spaced, so the distance from the newest one gives us the slots to blend directly.
+	const float Offset = FMath::Clamp((Newest.Timestamp - Time) / SnapshotInterval, 0.0f, static_cast<float>(NumSnapshots - 1));
+	OutNewerSteps = FMath::Min(FMath::FloorToInt(Offset), NumSnapshots - 1);
+	OutOlderSteps = FMath::Min(OutNewerSteps + 1, NumSnapshots - 1);
+	OutAlpha = Offset - OutNewerSteps;
+}
+
+bool UHitboxHistoryComponent::GetHitboxAtTime(float Time, FBox& OutHitbox) const
+{
+	if (NumSnapshots == 0)
+	{
+		return false;
+	}
+
+	int32 NewerSteps, OlderSteps;
+	float Alpha;
+	FindSnapshotsAtTime(Time, NewerSteps, OlderSteps, Alpha);
+
+	const int32 Capacity = Snapshots.Num();
+	const FHitboxSnapshot& Newer = Snapshots[(NewestIndex - NewerSteps + Capacity) % Capacity];
+	const FHitboxSnapshot& Older = Snapshots[(NewestIndex - OlderSteps + Capacity) % Capacity];
+
+	OutHitbox = FBox::BuildAABB(FMath::Lerp(Newer.Center, Older.Center, Alpha), FMath::Lerp(Newer.Extent, Older.Extent, Alpha));
+	return true;
+}
+
+bool UHitboxHistoryComponent::GetViewsSince(float Time, TArray<FViewSnapshot>& OutViews) const
+{
+	OutViews.Reset();
+	if (NumSnapshots == 0 || Views.Num() == 0)
+	{
+		return false;
+	}
+
+	int32 NewerSteps, OlderSteps;
+	float Alpha;
+	FindSnapshotsAtTime(Time, NewerSteps, OlderSteps, Alpha);
+
+	const int32 Capacity = Views.Num();
+	const FViewSnapshot& Newer = Views[(NewestIndex - NewerSteps + Capacity) % Capacity];
+	const FViewSnapshot& Older = Views[(NewestIndex - OlderSteps + Capacity) % Capacity];
+
+	// Stance can't be blended, so it's taken from the nearer snapshot.
+	FViewSnapshot& AtTime = OutViews.Add_GetRef(Alpha < 0.5f ? Newer : Older);
+	AtTime.Timestamp = FMath::Lerp(Newer.Timestamp, Older.Timestamp, Alpha);
+	AtTime.ViewLocation = FMath::Lerp(Newer.ViewLocation, Older.ViewLocation, Alpha);
+	// Blended along the shorter way round, so aims either side of +-180 degrees yaw don't sweep through the opposite direction.
+	AtTime.AimRotation = Newer.AimRotation + (Older.AimRotation - Newer.AimRotation).GetNormalized() * Alpha;
+
+	for (int32 Steps = NewerSteps; Steps >= 0; --Steps)
+	{
+		OutViews.Add(Views[(NewestIndex - Steps + Capacity) % Capacity]);
+	}
+
+	// The newest snapshot can be up to an interval old.
+	FViewSnapshot Current;
+	if (GetCurrentView(Current))
+	{
+		OutViews.Add(Current);
+	}
+	return true;
+}
@@ -4,13 +4,149 @@
 #include "CollisionQueryParams.h"
 #include "Engine/World.h"
 #include "GameFramework/Actor.h"
+#include "Components/PrimitiveComponent.h"
 #include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/Pawn.h"
+#include "Net/DataBunch.h"
+#include "Weapons/HitscanManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("TwoPhaseLineTrace"), STAT_GDKTwoPhaseLineTrace, STATGROUP_GDKShooter);
+
+namespace
+{
+	// Candidates whose complex collision is missed are skipped, up to this many per shot.
+	const int32 MaxTwoPhaseCandidates = 4;
+
+	enum EHitInfoFlags : uint8
+	{
+		HitInfoFlag_DidHit = 1 << 0,
+		HitInfoFlag_HasActor = 1 << 1,
+		HitInfoFlag_HasShotIndex = 1 << 2,
+		HitInfoFlag_NumBits = 3
+	};
+
+	// Size of FInstantHitInfo as replicated property by property: location, bool, fire time and shot index, excluding the actor.
+	const int32 UnpackedHitInfoBits = 3 * 32 + 1 + 32 + 32;
+
+	void MeasureHitInfoWireSize(const TArray<FString>& Args, UWorld* World)
+	{
+		// Actor references can only be measured with a connection's package map.
+		UPackageMap* PackageMap = nullptr;
+		if (UNetDriver* NetDriver = World->GetNetDriver())
+		{
+			UNetConnection* Connection = NetDriver->ServerConnection != nullptr ? NetDriver->ServerConnection
+				: (NetDriver->ClientConnections.Num() > 0 ? NetDriver->ClientConnections[0] : nullptr);
+			PackageMap = Connection != nullptr ? Connection->PackageMap : nullptr;
+		}
+
+		AActor* SampleActor = nullptr;
+		if (PackageMap != nullptr)
+		{
+			for (FConstPawnIterator It = World->GetPawnIterator(); It; ++It)
+			{
+				SampleActor = It->Get();
+				break;
+			}
+		}
+
+		FInstantHitInfo Hit;
+		Hit.Location = FVector(12345.6f, -4321.9f, 250.3f);
+		Hit.HitActor = SampleActor;
+		Hit.bDidHit = true;
+		Hit.FireTime = World->GetTimeSeconds();
+		Hit.ShotIndex = 1234;
+
+		FInstantHitInfo Miss = Hit;
+		Miss.HitActor = nullptr;
+		Miss.bDidHit = false;
+
+		auto MeasureBits = [PackageMap](FInstantHitInfo& HitInfo)
+		{
+			FNetBitWriter Writer(PackageMap, 1024);
+			bool bSuccess = true;
+			HitInfo.NetSerialize(Writer, PackageMap, bSuccess);
+			return Writer.GetNumBits();
+		};
+
+		auto MeasureActorBits = [PackageMap](AActor* Actor)
+		{
+			if (PackageMap == nullptr)
+			{
+				return (int64)0;
+			}
+			FNetBitWriter Writer(PackageMap, 256);
+			UObject* Object = Actor;
+			Writer << Object;
+			return Writer.GetNumBits();
+		};
+
+		const int64 HitBits = MeasureBits(Hit);
+		const int64 MissBits = MeasureBits(Miss);
+		const int64 UnpackedHitBits = UnpackedHitInfoBits + MeasureActorBits(SampleActor);
+		const int64 UnpackedMissBits = UnpackedHitInfoBits + MeasureActorBits(nullptr);
+
+		UE_LOG(LogGDK, Display, TEXT("GDK.HitInfoWireSize: hit %lld bits (was %lld), miss %lld bits (was %lld)%s"),
+			HitBits, UnpackedHitBits, MissBits, UnpackedMissBits,
+			SampleActor == nullptr ? TEXT(", excluding actor references: no connection or pawn to measure them with") : TEXT(""));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs HitInfoWireSizeCommand(
+	TEXT("GDK.HitInfoWireSize"),
+	TEXT("Logs the number of bits a shot report takes on the wire, compared with property-by-property replication."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&MeasureHitInfoWireSize));
+
+bool FInstantHitInfo::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Flags = 0;
+	if (Ar.IsSaving())
+	{
+		Flags |= bDidHit ? HitInfoFlag_DidHit : 0;
+		Flags |= bDidHit && HitActor != nullptr ? HitInfoFlag_HasActor : 0;
+		Flags |= ShotIndex != INDEX_NONE ? HitInfoFlag_HasShotIndex : 0;
+	}
+	Ar.SerializeBits(&Flags, HitInfoFlag_NumBits);
+
+	// Absolute rather than relative to the hit actor, since the actor is in a different place on every machine.
+	// Fails for locations outside the quantized range, which are clamped to it.
+	bOutSuccess = SerializePackedVector<10, 24>(Location, Ar);
+	// Kept as a full float: server time grows without bound, and the sender has no time that the receiver
+	// is guaranteed to agree on to quantize it against. Rewinding needs it to well under a snapshot interval.
+	Ar << FireTime;
+
+	uint32 PackedShotIndex = ShotIndex;
+	if (Flags & HitInfoFlag_HasShotIndex)
+	{
+		Ar.SerializeIntPacked(PackedShotIndex);
+	}
+
+	UObject* Actor = HitActor;
+	if (Flags & HitInfoFlag_HasActor)
+	{
+		Ar << Actor;
+	}
+
+	if (Ar.IsLoading())
+	{
+		bDidHit = (Flags & HitInfoFlag_DidHit) != 0;
+		ShotIndex = (Flags & HitInfoFlag_HasShotIndex) ? static_cast<int32>(PackedShotIndex) : INDEX_NONE;
+		HitActor = (Flags & HitInfoFlag_HasActor) ? Cast<AActor>(Actor) : nullptr;
+	}
+
+	return true;
+}
 
 UShootingComponent::UShootingComponent()
 {
 	PrimaryComponentTick.bCanEverTick = false;
 
 	MaxRange = 50000.0f;
+	HitscanManager = nullptr;
+	NextAsyncBatchId = 0;
 }
 
 void UShootingComponent::BeginPlay()
@@ -36,13 +172,18 @@ void UShootingComponent::BeginPlay()
 		UE_LOG(LogGDK, Error, TEXT("Shooting Component on %s exists without a Trace Providing component, please add an Actor Component that implements ITraceProvider."),
 			*GetPathNameSafe(GetOwner()));
 	}
+
+	AsyncTraceDelegate.BindUObject(this, &UShootingComponent::OnAsyncTraceDone);
+
+	if (TraceMode == EShootingTraceMode::HitscanProxies)
+	{
+		HitscanManager = AGDKWorldManager::Get<AHitscanManager>(this);
+	}
 }
 
 
-FInstantHitInfo UShootingComponent::DoLineTrace(FVector Direction, AActor* ActorToIgnore)
+FCollisionQueryParams UShootingComponent::MakeTraceParams(AActor* ActorToIgnore) const
 {
-	FInstantHitInfo OutHitInfo;
-	
 	FCollisionQueryParams TraceParams;
 	TraceParams.bTraceComplex = true;
 	TraceParams.bReturnPhysicalMaterial = false;
@@ -55,17 +196,12 @@ FInstantHitInfo UShootingComponent::DoLineTrace(FVector Direction, AActor* Actor
 			TraceParams.AddIgnoredActor(ActorToIgnoresOwner);
 		}
 	}
+	return TraceParams;
+}
 
-	FHitResult HitResult(ForceInit);
-	FVector TraceStart = GetLineTraceStart();
-	FVector TraceEnd = TraceStart + Direction * MaxRange;
-
-	bool bDidHit = GetWorld()->LineTraceSingleByChannel(
-		HitResult,
-		TraceStart,
-		TraceEnd,
-		TraceChannel,
-		TraceParams);
+FInstantHitInfo UShootingComponent::MakeHitInfo(bool bDidHit, const FHitResult& HitResult, const FVector& TraceEnd)
+{
+	FInstantHitInfo OutHitInfo;
 
 	if (!bDidHit)
 	{
@@ -80,3 +216,161 @@ FInstantHitInfo UShootingComponent::DoLineTrace(FVector Direction, AActor* Actor
 
 	return OutHitInfo;
 }
+
+FInstantHitInfo UShootingComponent::DoLineTrace(FVector Direction, AActor* ActorToIgnore)
+{
+	FCollisionQueryParams TraceParams = MakeTraceParams(ActorToIgnore);
+
+	FHitResult HitResult(ForceInit);
+	FVector TraceStart = GetLineTraceStart();
+	FVector TraceEnd = TraceStart + Direction * MaxRange;
+
+	bool bDidHit = false;
+	if (TraceMode == EShootingTraceMode::HitscanProxies && HitscanManager != nullptr)
+	{
+		bDidHit = HitscanManager->LineTrace(HitResult, TraceStart, TraceEnd, TraceChannel, TraceParams);
+	}
+	else if (TraceMode == EShootingTraceMode::TwoPhase)
+	{
+		bDidHit = TwoPhaseLineTrace(HitResult, TraceStart, TraceEnd, TraceParams);
+	}
+	else
+	{
+		bDidHit = GetWorld()->LineTraceSingleByChannel(
+			HitResult,
+			TraceStart,
+			TraceEnd,
+			TraceChannel,
+			TraceParams);
+	}
+
+	return MakeHitInfo(bDidHit, HitResult, TraceEnd);
+}
+
+void UShootingComponent::AsyncLineTraceBatch(const TArray<FVector>& Directions, AActor* ActorToIgnore, const FLineTraceBatchComplete& OnComplete)
+{
+	check(Directions.Num() <= MaxAsyncBatchSize);
+
+	// Proxy and two-phase traces don't go through the physics scene in a single query, so they can't be deferred.
+	if (TraceMode != EShootingTraceMode::Complex || Directions.Num() == 0)
+	{
+		TArray<FInstantHitInfo> Results;
+		Results.Reserve(Directions.Num());
+		for (const FVector& Direction : Directions)
+		{
+			Results.Add(DoLineTrace(Direction, ActorToIgnore));
+		}
+		OnComplete.ExecuteIfBound(Results);
+		return;
+	}
+
+	// Batch ids fill the upper bits of the trace user data, and the index in the batch the lower 8.
+	const uint32 BatchId = NextAsyncBatchId;
+	NextAsyncBatchId = (NextAsyncBatchId + 1) & 0x00FFFFFF;
+
+	FAsyncTraceBatch& Batch = AsyncTraceBatches.Add(BatchId);
+	Batch.Results.SetNum(Directions.Num());
+	Batch.NumRemaining = Directions.Num();
+	Batch.OnComplete = OnComplete;
+
+	const FCollisionQueryParams TraceParams = MakeTraceParams(ActorToIgnore);
+	const FVector TraceStart = GetLineTraceStart();
+
+	for (int32 Index = 0; Index < Directions.Num(); ++Index)
+	{
+		GetWorld()->AsyncLineTraceByChannel(
+			EAsyncTraceType::Single,
+			TraceStart,
+			TraceStart + Directions[Index] * MaxRange,
+			TraceChannel,
+			TraceParams,
+			FCollisionResponseParams::DefaultResponseParam,
+			&AsyncTraceDelegate,
+			(BatchId << 8) | Index);
+	}
+}
+
+void UShootingComponent::OnAsyncTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData)
+{
+	const uint32 BatchId = TraceData.UserData >> 8;
+	const int32 Index = TraceData.UserData & 0xFF;
+
+	FAsyncTraceBatch* Batch = AsyncTraceBatches.Find(BatchId);
+	if (Batch == nullptr || !Batch->Results.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	const bool bDidHit = TraceData.OutHits.Num() > 0 && TraceData.OutHits[0].bBlockingHit;
+	Batch->Results[Index] = MakeHitInfo(bDidHit, bDidHit ? TraceData.OutHits[0] : FHitResult(), TraceData.End);
+
+	if (--Batch->NumRemaining == 0)
+	{
+		// Remove the batch before calling out, in case the callback submits another one.
+		FAsyncTraceBatch CompletedBatch = MoveTemp(*Batch);
+		AsyncTraceBatches.Remove(BatchId);
+		CompletedBatch.OnComplete.ExecuteIfBound(CompletedBatch.Results);
+	}
+}
+
+bool UShootingComponent::TwoPhaseLineTrace(FHitResult& OutHit, const FVector& TraceStart, const FVector& TraceEnd, const FCollisionQueryParams& TraceParams) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKTwoPhaseLineTrace);
+
+	FCollisionQueryParams SimpleParams = TraceParams;
+	SimpleParams.bTraceComplex = false;
+	FCollisionQueryParams ComplexParams = TraceParams;
+	ComplexParams.bTraceComplex = true;
+
+	bool bDidHit = false;
+	FVector SearchEnd = TraceEnd;
+
+	for (int32 Candidate = 0; Candidate < MaxTwoPhaseCandidates; ++Candidate)
+	{
+		FHitResult SimpleHit(ForceInit);
+		if (!GetWorld()->LineTraceSingleByChannel(SimpleHit, TraceStart, SearchEnd, TraceChannel, SimpleParams))
+		{
+			return bDidHit;
+		}
+
+		AActor* CandidateActor = SimpleHit.GetActor();
+		if (CandidateActor == nullptr)
+		{
+			// Nothing to refine against, so the simple hit is the best we have.
+			OutHit = SimpleHit;
+			return true;
+		}
+
+		// Simple collision usually encloses the complex mesh, so the refined hit can only be further along the ray.
+		// Anything in front of it is found by the next simple trace, with this candidate ignored.
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(CandidateActor);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (!Primitive->IsCollisionEnabled() || Primitive->GetCollisionResponseToChannel(TraceChannel) != ECR_Block)
+			{
+				continue;
+			}
+
+			FHitResult ComplexHit(ForceInit);
+			if (Primitive->LineTraceComponent(ComplexHit, TraceStart, SearchEnd, ComplexParams))
+			{
+				OutHit = ComplexHit;
+				SearchEnd = ComplexHit.ImpactPoint;
+				bDidHit = true;
+			}
+		}
+
+		SimpleParams.AddIgnoredActor(CandidateActor);
+		ComplexParams.AddIgnoredActor(CandidateActor);
+	}
+
+	// Too many candidates, e.g. a crowd or dense foliage. Trace what's left of the ray, up to the nearest refined hit, in one go.
+	FHitResult ComplexHit(ForceInit);
+	if (GetWorld()->LineTraceSingleByChannel(ComplexHit, TraceStart, SearchEnd, TraceChannel, ComplexParams))
+	{
+		OutHit = ComplexHit;
+		bDidHit = true;
+	}
+
+	return bDidHit;
+}
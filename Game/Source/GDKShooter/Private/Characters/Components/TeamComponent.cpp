@@ -1,6 +1,7 @@
 // Copyright (c) Improbable Worlds Ltd, All Rights Reserved
 
 #include "TeamComponent.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "UnrealNetwork.h"
 
 #include "Engine/World.h"
@@ -31,7 +32,7 @@ bool UTeamComponent::CanDamageActor(AActor* OtherActor)
 		return true;
 	}
 
-	if (UTeamComponent* OtherTeamComponent = Cast<UTeamComponent>(OtherActor->GetComponentByClass(UTeamComponent::StaticClass())))
+	if (UTeamComponent* OtherTeamComponent = FComponentRegistry::Get<UTeamComponent>(OtherActor))
 	{
 		return !OtherTeamComponent->HasTeam() || OtherTeamComponent->GetTeam() != GetTeam();
 	}
@@ -10,7 +10,11 @@
 #include "GDKLogging.h"
 #include "Controllers/GDKPlayerController.h"
 #include "Controllers/Components/ControllerEventsComponent.h"
+#include "GameFramework/DamageableGrid.h"
+#include "GameFramework/MovementNetLOD.h"
+#include "GDKStats.h"
 #include "Weapons/Holdable.h"
+#include "Weapons/HitscanManager.h"
 
 AGDKCharacter::AGDKCharacter(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer.SetDefaultSubobjectClass<UGDKMovementComponent>(ACharacter::CharacterMovementComponentName))
@@ -22,6 +26,7 @@ AGDKCharacter::AGDKCharacter(const FObjectInitializer& ObjectInitializer)
 	EquippedComponent = CreateDefaultSubobject<UEquippedComponent>(TEXT("Equipment"));
 	MetaDataComponent = CreateDefaultSubobject<UMetaDataComponent>(TEXT("MetaData"));
 	TeamComponent = CreateDefaultSubobject<UTeamComponent>(TEXT("Team"));
+	HitboxHistoryComponent = CreateDefaultSubobject<UHitboxHistoryComponent>(TEXT("HitboxHistory"));
 	GDKMovementComponent = Cast<UGDKMovementComponent>(GetCharacterMovement());
 }
 
@@ -32,6 +37,71 @@ void AGDKCharacter::BeginPlay()
 
 	EquippedComponent->HoldableUpdated.AddDynamic(this, &AGDKCharacter::OnEquippedUpdated);
 	GDKMovementComponent->SprintingUpdated.AddDynamic(EquippedComponent, &UEquippedComponent::SetIsSprinting);
+
+	// The manager only exists if a shooting component traces against proxies. If it's spawned later, it registers us then.
+	if (AHitscanManager* HitscanManager = AGDKWorldManager::Find<AHitscanManager>(this))
+	{
+		HitscanManager->RegisterProxy(GetCapsuleComponent());
+	}
+
+	// Only servers apply radial damage.
+	if (GetNetMode() != NM_Client)
+	{
+		if (ADamageableGrid* DamageableGrid = AGDKWorldManager::Get<ADamageableGrid>(this))
+		{
+			DamageableGrid->Register(this);
+		}
+	}
+
+	if (GetNetMode() != NM_Standalone)
+	{
+		if (AMovementNetLOD* MovementNetLOD = AGDKWorldManager::Get<AMovementNetLOD>(this))
+		{
+			MovementNetLOD->Register(this);
+		}
+	}
+}
+
+void AGDKCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (AHitscanManager* HitscanManager = AGDKWorldManager::Find<AHitscanManager>(this))
+	{
+		HitscanManager->UnregisterProxy(GetCapsuleComponent());
+	}
+
+	if (ADamageableGrid* DamageableGrid = AGDKWorldManager::Find<ADamageableGrid>(this))
+	{
+		DamageableGrid->Unregister(this);
+	}
+
+	if (AMovementNetLOD* MovementNetLOD = AGDKWorldManager::Find<AMovementNetLOD>(this))
+	{
+		MovementNetLOD->Unregister(this);
+	}
+
+	if (DeletionTimer.IsValid())
+	{
+		if (ATimerWheelManager* TimerWheel = AGDKWorldManager::Find<ATimerWheelManager>(this))
+		{
+			TimerWheel->ClearTimer(DeletionTimer);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGDKCharacter::OnAuthorityGained()
+{
+	Super::OnAuthorityGained();
+
+	HitboxHistoryComponent->OnAuthorityGained();
+}
+
+void AGDKCharacter::OnAuthorityLost()
+{
+	Super::OnAuthorityLost();
+
+	HitboxHistoryComponent->OnAuthorityLost();
 }
 
 void AGDKCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -141,8 +211,10 @@ void AGDKCharacter::StartRagdoll_Implementation()
 
 	if (this->IsValidLowLevel() && RagdollLifetime >= 0.f)
 	{
-		DeletionDelegate.BindUFunction(this, FName("DeleteSelf"));
-		GetWorldTimerManager().SetTimer(DeletionTimer, DeletionDelegate, RagdollLifetime, false);
+		if (ATimerWheelManager* TimerWheel = AGDKWorldManager::Get<ATimerWheelManager>(this))
+		{
+			DeletionTimer = TimerWheel->SetTimer(RagdollLifetime, FSimpleDelegate::CreateUObject(this, &AGDKCharacter::DeleteSelf));
+		}
 	}
 }
 
@@ -157,15 +229,41 @@ void AGDKCharacter::DeleteSelf()
 
 float AGDKCharacter::TakeDamage(float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	TakeDamageCrossServer(Damage, DamageEvent, EventInstigator, DamageCauser);
+	// Most hits land on actors this server already has authority over, which need no RPC.
+	if (HasAuthority())
+	{
+		INC_DWORD_STAT(STAT_GDKLocalDamageHits);
+		ApplyDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
+		return Damage;
+	}
+
+	if (DamageQueue == nullptr)
+	{
+		DamageQueue = AGDKWorldManager::Get<ACrossServerDamageQueue>(this);
+	}
+	if (DamageQueue != nullptr)
+	{
+		DamageQueue->Add(this, FCrossServerDamage(Damage, DamageEvent, EventInstigator, DamageCauser),
+			FSendCrossServerDamage::CreateUObject(this, &AGDKCharacter::TakeDamageCrossServer));
+	}
 	return Damage;
 }
 
-void AGDKCharacter::TakeDamageCrossServer_Implementation(float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+void AGDKCharacter::TakeDamageCrossServer_Implementation(const TArray<FCrossServerDamage>& Hits)
+{
+	for (const FCrossServerDamage& Hit : Hits)
+	{
+		Hit.Dispatch(this, [this, &Hit](float Damage, const FDamageEvent& DamageEvent)
+		{
+			ApplyDamage(Damage, DamageEvent, Hit.EventInstigator, Hit.DamageCauser);
+		});
+	}
+}
+
+void AGDKCharacter::ApplyDamage(float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
 	float ActualDamage = Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
 	HealthComponent->TakeDamage(ActualDamage, DamageEvent, EventInstigator, DamageCauser);
-
 }
 
 FGenericTeamId AGDKCharacter::GetGenericTeamId() const
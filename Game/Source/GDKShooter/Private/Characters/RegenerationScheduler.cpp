@@ -0,0 +1,194 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "RegenerationScheduler.h"
+
+#include "Characters/Components/HealthComponent.h"
+#include "Engine/World.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("RegenerationPass"), STAT_GDKRegenerationPass, STATGROUP_GDKShooter);
+DECLARE_CYCLE_STAT(TEXT("DelayRegeneration"), STAT_GDKDelayRegeneration, STATGROUP_GDKShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RegeneratingComponents"), STAT_GDKRegeneratingComponents, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkRegenerationCommand(
+	TEXT("GDK.BenchmarkRegeneration"),
+	TEXT("Compares re-arming regeneration timers with updating regeneration scheduler entries. Usage: GDK.BenchmarkRegeneration [N]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ARegenerationScheduler::RunBenchmark));
+
+namespace
+{
+	// Regenerations a single entry can catch up on in one pass, after a hitch.
+	const int32 MaxRegenerationsPerPass = 8;
+}
+
+const float ARegenerationScheduler::UpdateInterval = 0.1f;
+
+ARegenerationScheduler::ARegenerationScheduler()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickInterval = UpdateInterval;
+}
+
+void ARegenerationScheduler::DelayRegeneration(UHealthComponent* Component)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKDelayRegeneration);
+
+	if (Component->RegenerationIndex == INDEX_NONE)
+	{
+		Component->RegenerationIndex = Entries.AddDefaulted();
+		Entries[Component->RegenerationIndex].Component = Component;
+		SetActorTickEnabled(true);
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	FRegenerationEntry& Entry = Entries[Component->RegenerationIndex];
+	Entry.NextHealthTime = Component->HealthRegenInterval > 0.f ? Now + Component->HealthRegenCooldown : MAX_flt;
+	Entry.NextArmourTime = Component->ArmourRegenInterval > 0.f ? Now + Component->ArmourRegenCooldown : MAX_flt;
+}
+
+void ARegenerationScheduler::Unregister(UHealthComponent* Component)
+{
+	if (Entries.IsValidIndex(Component->RegenerationIndex) && Entries[Component->RegenerationIndex].Component == Component)
+	{
+		RemoveAt(Component->RegenerationIndex);
+	}
+}
+
+void ARegenerationScheduler::RemoveAt(int32 Index)
+{
+	if (UHealthComponent* Component = Entries[Index].Component.Get())
+	{
+		Component->RegenerationIndex = INDEX_NONE;
+	}
+
+	Entries.RemoveAtSwap(Index, 1, false);
+	if (Entries.IsValidIndex(Index))
+	{
+		if (UHealthComponent* Moved = Entries[Index].Component.Get())
+		{
+			Moved->RegenerationIndex = Index;
+		}
+	}
+}
+
+void ARegenerationScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_GDKRegenerationPass);
+	SET_DWORD_STAT(STAT_GDKRegeneratingComponents, Entries.Num());
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// Backwards, so that removing an entry only moves one already processed.
+	for (int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		FRegenerationEntry& Entry = Entries[Index];
+		UHealthComponent* Component = Entry.Component.Get();
+		if (Component == nullptr)
+		{
+			RemoveAt(Index);
+			continue;
+		}
+
+		// Regenerate as many times as the interval allows since the last pass, so the rate doesn't depend on UpdateInterval.
+		for (int32 Count = 0; Count < MaxRegenerationsPerPass && Entry.NextHealthTime <= Now; ++Count)
+		{
+			Component->RegenerateHealth();
+			Entry.NextHealthTime += Component->HealthRegenInterval;
+		}
+		for (int32 Count = 0; Count < MaxRegenerationsPerPass && Entry.NextArmourTime <= Now; ++Count)
+		{
+			Component->RegenerateArmour();
+			Entry.NextArmourTime += Component->ArmourRegenInterval;
+		}
+
+		// Both regenerations only ever grant health, to the living, so there is nothing more to do until the next hit.
+		if (Component->GetCurrentHealth() <= 0.f || Component->GetCurrentHealth() >= Component->GetMaxHealth())
+		{
+			RemoveAt(Index);
+		}
+	}
+
+	if (Entries.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void ARegenerationScheduler::RunBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	ARegenerationScheduler* Scheduler = AGDKWorldManager::Get<ARegenerationScheduler>(World);
+	if (Scheduler == nullptr)
+	{
+		UE_LOG(LogGDK, Warning, TEXT("GDK.BenchmarkRegeneration: no game world to benchmark in."));
+		return;
+	}
+
+	const int32 NumComponents = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+	const int32 HitsPerComponent = 10;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	AActor* Owner = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+
+	TArray<UHealthComponent*> Components;
+	for (int32 Index = 0; Index < NumComponents; ++Index)
+	{
+		UHealthComponent* Component = NewObject<UHealthComponent>(Owner);
+		Component->HealthRegenInterval = 1.f;
+		Component->HealthRegenCooldown = 5.f;
+		Component->ArmourRegenInterval = 1.f;
+		Component->ArmourRegenCooldown = 5.f;
+		Component->RegisterComponent();
+		Components.Add(Component);
+	}
+
+	// What each hit used to do: clear and re-arm a health and an armour timer on the timer manager.
+	FTimerManager& TimerManager = World->GetTimerManager();
+	TArray<FTimerHandle> HealthHandles;
+	TArray<FTimerHandle> ArmourHandles;
+	HealthHandles.SetNum(NumComponents);
+	ArmourHandles.SetNum(NumComponents);
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Hit = 0; Hit < HitsPerComponent; ++Hit)
+	{
+		for (int32 Index = 0; Index < NumComponents; ++Index)
+		{
+			UHealthComponent* Component = Components[Index];
+			TimerManager.ClearTimer(HealthHandles[Index]);
+			TimerManager.ClearTimer(ArmourHandles[Index]);
+			TimerManager.SetTimer(HealthHandles[Index], Component, &UHealthComponent::RegenerateHealth, Component->HealthRegenInterval, true, Component->HealthRegenCooldown);
+			TimerManager.SetTimer(ArmourHandles[Index], Component, &UHealthComponent::RegenerateArmour, Component->ArmourRegenInterval, true, Component->ArmourRegenCooldown);
+		}
+	}
+	const double TimerSeconds = FPlatformTime::Seconds() - StartTime;
+
+	for (int32 Index = 0; Index < NumComponents; ++Index)
+	{
+		TimerManager.ClearTimer(HealthHandles[Index]);
+		TimerManager.ClearTimer(ArmourHandles[Index]);
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Hit = 0; Hit < HitsPerComponent; ++Hit)
+	{
+		for (UHealthComponent* Component : Components)
+		{
+			Scheduler->DelayRegeneration(Component);
+		}
+	}
+	const double SchedulerSeconds = FPlatformTime::Seconds() - StartTime;
+
+	Owner->Destroy();
+
+	const int32 NumHits = NumComponents * HitsPerComponent;
+	UE_LOG(LogGDK, Display, TEXT("GDK.BenchmarkRegeneration: %d components, %d hits."), NumComponents, NumHits);
+	UE_LOG(LogGDK, Display, TEXT("  Timer manager:          %8.1f ns per hit"), TimerSeconds * 1.e9 / NumHits);
+	UE_LOG(LogGDK, Display, TEXT("  Regeneration scheduler: %8.1f ns per hit"), SchedulerSeconds * 1.e9 / NumHits);
+}
@@ -0,0 +1,134 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "ServerMoveScheduler.h"
+
+#include "Characters/Components/GDKMovementComponent.h"
+#include "Engine/World.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("ServerMovePass"), STAT_GDKServerMovePass, STATGROUP_GDKShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("BatchedServerMoves"), STAT_GDKBatchedServerMoves, STATGROUP_GDKShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("ServerMovesPerSecondPerCore"), STAT_GDKServerMovesPerSecondPerCore, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs ServerMoveThroughputCommand(
+	TEXT("GDK.ServerMoveThroughput"),
+	TEXT("Logs the batched client moves processed since the last call, and how many moves per second one core can process."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&AServerMoveScheduler::LogThroughput));
+
+namespace
+{
+	// Width of the cells characters are sorted by, in world units.
+	const float SortCellSize = 2000.0f;
+
+	// Spreads the low 16 bits of Value out to the even bits.
+	uint32 SpreadBits(uint32 Value)
+	{
+		Value &= 0xFFFF;
+		Value = (Value | (Value << 8)) & 0x00FF00FF;
+		Value = (Value | (Value << 4)) & 0x0F0F0F0F;
+		Value = (Value | (Value << 2)) & 0x33333333;
+		Value = (Value | (Value << 1)) & 0x55555555;
+		return Value;
+	}
+
+	// Position of the location's cell along a Z-order curve on the horizontal plane.
+	uint32 GetSortKey(const FVector& Location)
+	{
+		const uint32 X = static_cast<uint32>(FMath::FloorToInt(Location.X / SortCellSize) + 0x8000);
+		const uint32 Y = static_cast<uint32>(FMath::FloorToInt(Location.Y / SortCellSize) + 0x8000);
+		return SpreadBits(X) | (SpreadBits(Y) << 1);
+	}
+}
+
+AServerMoveScheduler::AServerMoveScheduler()
+	: NumMovesProcessed(0)
+	, ProcessingSeconds(0.0)
+	, ThroughputStartTime(0.0)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+void AServerMoveScheduler::Enqueue(UGDKMovementComponent* Movement)
+{
+	Pending.Add(Movement);
+	SetActorTickEnabled(true);
+}
+
+void AServerMoveScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_GDKServerMovePass);
+
+	if (ThroughputStartTime == 0.0)
+	{
+		ThroughputStartTime = FPlatformTime::Seconds();
+	}
+
+	Scheduled.Reset();
+	for (const TWeakObjectPtr<UGDKMovementComponent>& PendingMovement : Pending)
+	{
+		UGDKMovementComponent* Movement = PendingMovement.Get();
+		if (Movement != nullptr && Movement->UpdatedComponent != nullptr)
+		{
+			FScheduledMovement& Entry = Scheduled.AddDefaulted_GetRef();
+			Entry.SortKey = GetSortKey(Movement->UpdatedComponent->GetComponentLocation());
+			Entry.Movement = Movement;
+		}
+		else if (Movement != nullptr)
+		{
+			Movement->QueuedServerMoves.Reset();
+		}
+	}
+	Pending.Reset();
+
+	Scheduled.Sort([](const FScheduledMovement& A, const FScheduledMovement& B)
+	{
+		return A.SortKey < B.SortKey;
+	});
+
+	const double StartTime = FPlatformTime::Seconds();
+	int32 NumMoves = 0;
+	for (const FScheduledMovement& Entry : Scheduled)
+	{
+		NumMoves += Entry.Movement->ProcessQueuedServerMoves();
+	}
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	INC_DWORD_STAT_BY(STAT_GDKBatchedServerMoves, NumMoves);
+	if (NumMoves > 0 && Seconds > 0.0)
+	{
+		SET_FLOAT_STAT(STAT_GDKServerMovesPerSecondPerCore, NumMoves / Seconds);
+	}
+	NumMovesProcessed += NumMoves;
+	ProcessingSeconds += Seconds;
+
+	// Moves that arrive before the next frame turn it back on.
+	SetActorTickEnabled(false);
+}
+
+void AServerMoveScheduler::LogThroughput(const TArray<FString>& Args, UWorld* World)
+{
+	AServerMoveScheduler* Scheduler = AGDKWorldManager::Find<AServerMoveScheduler>(World);
+	if (Scheduler == nullptr || Scheduler->NumMovesProcessed == 0)
+	{
+		UE_LOG(LogGDK, Display, TEXT("GDK.ServerMoveThroughput: no batched moves processed. Set bBatchServerMoves on the characters' movement components."));
+		return;
+	}
+
+	const double WallSeconds = FPlatformTime::Seconds() - Scheduler->ThroughputStartTime;
+	UE_LOG(LogGDK, Display, TEXT("GDK.ServerMoveThroughput: %lld moves in %.1f s, %.0f moves per second received."),
+		Scheduler->NumMovesProcessed, WallSeconds, Scheduler->NumMovesProcessed / FMath::Max(WallSeconds, 0.001));
+	UE_LOG(LogGDK, Display, TEXT("  %.1f us per move, %.0f moves per second per core, %.1f%% of a core spent on moves."),
+		Scheduler->ProcessingSeconds * 1.e6 / Scheduler->NumMovesProcessed,
+		Scheduler->NumMovesProcessed / FMath::Max(Scheduler->ProcessingSeconds, 1.e-6),
+		100.0 * Scheduler->ProcessingSeconds / FMath::Max(WallSeconds, 0.001));
+
+	Scheduler->NumMovesProcessed = 0;
+	Scheduler->ProcessingSeconds = 0.0;
+	Scheduler->ThroughputStartTime = FPlatformTime::Seconds();
+}
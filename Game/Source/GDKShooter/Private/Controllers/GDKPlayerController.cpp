@@ -13,6 +13,7 @@
 #include "Game/Components/SpawnRequestPublisher.h"
 #include "Game/Components/PlayerPublisher.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "GameFramework/GameStateBase.h"
 #include "GameFramework/PlayerState.h"
 #include "GameFramework/SpringArmComponent.h"
@@ -49,7 +50,7 @@ void AGDKPlayerController::BeginPlay()
 
 	if (PlayerState)
 	{
-		if (UPlayerPublisher* PlayerPublisher = Cast<UPlayerPublisher>(GetWorld()->GetGameState()->GetComponentByClass(UPlayerPublisher::StaticClass())))
+		if (UPlayerPublisher* PlayerPublisher = FComponentRegistry::Get<UPlayerPublisher>(GetWorld()->GetGameState()))
 		{
 			PlayerPublisher->PublishPlayer(PlayerState, EPlayerProgress::Connected);
 		}
@@ -116,7 +117,7 @@ void AGDKPlayerController::SetUIMode(bool bIsUIMode)
 
 	if (GetPawn())
 	{
-		if (UEquippedComponent* EquippedComponent = Cast<UEquippedComponent>(GetPawn()->GetComponentByClass(UEquippedComponent::StaticClass())))
+		if (UEquippedComponent* EquippedComponent = FComponentRegistry::Get<UEquippedComponent>(GetPawn()))
 		{
 			EquippedComponent->BlockUsing(bIsUIMode);
 		}
@@ -126,7 +127,7 @@ void AGDKPlayerController::SetUIMode(bool bIsUIMode)
 void AGDKPlayerController::ServerTryJoinGame_Implementation()
 {
 
-	if (USpawnRequestPublisher* Spawner = Cast<USpawnRequestPublisher>(GetWorld()->GetGameState()->GetComponentByClass(USpawnRequestPublisher::StaticClass())))
+	if (USpawnRequestPublisher* Spawner = FComponentRegistry::Get<USpawnRequestPublisher>(GetWorld()->GetGameState()))
 	{
 		Spawner->RequestSpawn(this);
 		return;
@@ -153,7 +154,7 @@ bool AGDKPlayerController::ServerRequestName_Validate(const FString& NewPlayerNa
 
 void AGDKPlayerController::ServerRequestMetaData_Implementation(const FGDKMetaData NewMetaData)
 {
-	if (UMetaDataComponent* MetaData = Cast<UMetaDataComponent>(PlayerState->GetComponentByClass(UMetaDataComponent::StaticClass())))
+	if (UMetaDataComponent* MetaData = FComponentRegistry::Get<UMetaDataComponent>(PlayerState))
 	{
 		MetaData->SetMetaData(NewMetaData);
 	}
@@ -166,7 +167,7 @@ bool AGDKPlayerController::ServerRequestMetaData_Validate(const FGDKMetaData New
 
 void AGDKPlayerController::ServerRespawnCharacter_Implementation()
 {
-	if (USpawnRequestPublisher* Spawner = Cast<USpawnRequestPublisher>(GetWorld()->GetGameState()->GetComponentByClass(USpawnRequestPublisher::StaticClass())))
+	if (USpawnRequestPublisher* Spawner = FComponentRegistry::Get<USpawnRequestPublisher>(GetWorld()->GetGameState()))
 	{
 		Spawner->RequestSpawn(this);
 		return;
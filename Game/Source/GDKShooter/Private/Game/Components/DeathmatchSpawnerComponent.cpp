@@ -6,6 +6,7 @@
 #include "Components/TeamComponent.h"
 #include "Engine/World.h"
 #include "Game/Components/PlayerPublisher.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "GameFramework/GameModeBase.h"
 #include "GameFramework/GameStateBase.h"
 #include "GDKLogging.h"
@@ -23,7 +24,7 @@ void UDeathmatchSpawnerComponent::RequestSpawn(APlayerController* Controller)
 
 	if (Controller->PlayerState)
 	{
-		if (UPlayerPublisher* PlayerPublisher = Cast<UPlayerPublisher>(GetWorld()->GetGameState()->GetComponentByClass(UPlayerPublisher::StaticClass())))
+		if (UPlayerPublisher* PlayerPublisher = FComponentRegistry::Get<UPlayerPublisher>(GetWorld()->GetGameState()))
 		{
 			PlayerPublisher->PublishPlayer(Controller->PlayerState, EPlayerProgress::InGame);
 		}
@@ -73,9 +74,9 @@ void UDeathmatchSpawnerComponent::SpawnCharacter(APlayerController* Controller)
 
 		Controller->Possess(NewPawn);
 
-		if (UMetaDataComponent* StateMetaData = Cast<UMetaDataComponent>(Controller->PlayerState->GetComponentByClass(UMetaDataComponent::StaticClass())))
+		if (UMetaDataComponent* StateMetaData = FComponentRegistry::Get<UMetaDataComponent>(Controller->PlayerState))
 		{
-			if (UMetaDataComponent* MetaData = Cast<UMetaDataComponent>(NewPawn->GetComponentByClass(UMetaDataComponent::StaticClass())))
+			if (UMetaDataComponent* MetaData = FComponentRegistry::Get<UMetaDataComponent>(NewPawn))
 			{
 				MetaData->SetMetaData(StateMetaData->GetMetaData());
 			}
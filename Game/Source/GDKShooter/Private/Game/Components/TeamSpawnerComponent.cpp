@@ -6,6 +6,7 @@
 #include "Components/TeamComponent.h"
 #include "EngineUtils.h"
 #include "Components/PlayerPublisher.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "GameFramework/GameModeBase.h"
 #include "GameFramework/GameStateBase.h"
 #include "GameFramework/PlayerController.h"
@@ -100,13 +101,13 @@ void UTeamSpawnerComponent::RequestSpawn(APlayerController* Controller)
 			return;
 		}
 
-		if (UMetaDataComponent* MetaDataComponent = Cast<UMetaDataComponent>(NewPawn->GetComponentByClass(UMetaDataComponent::StaticClass())))
+		if (UMetaDataComponent* MetaDataComponent = FComponentRegistry::Get<UMetaDataComponent>(NewPawn))
 		{
 			FGDKMetaData MetaData;
 			MetaData.Customization = TeamId;
 			MetaDataComponent->SetMetaData(MetaData);
 		}
-		if (UTeamComponent* TeamComponent = Cast<UTeamComponent>(NewPawn->GetComponentByClass(UTeamComponent::StaticClass())))
+		if (UTeamComponent* TeamComponent = FComponentRegistry::Get<UTeamComponent>(NewPawn))
 		{
 			TeamComponent->SetTeam(FGenericTeamId(TeamId));
 		}
@@ -117,7 +118,7 @@ void UTeamSpawnerComponent::RequestSpawn(APlayerController* Controller)
 
 		if (Controller->PlayerState != nullptr)
 		{
-			if (UTeamComponent* TeamComponent = Cast<UTeamComponent>(Controller->PlayerState->GetComponentByClass(UTeamComponent::StaticClass())))
+			if (UTeamComponent* TeamComponent = FComponentRegistry::Get<UTeamComponent>(Controller->PlayerState))
 			{
 				TeamComponent->SetTeam(FGenericTeamId(TeamId));
 			}
@@ -126,7 +127,7 @@ void UTeamSpawnerComponent::RequestSpawn(APlayerController* Controller)
 				UE_LOG(LogGDK, Error, TEXT("TeamComponent Required on PlayerState"));
 			}
 
-			if (UPlayerPublisher* PlayerPublisher = Cast<UPlayerPublisher>(GetWorld()->GetGameState()->GetComponentByClass(UPlayerPublisher::StaticClass())))
+			if (UPlayerPublisher* PlayerPublisher = FComponentRegistry::Get<UPlayerPublisher>(GetWorld()->GetGameState()))
 			{
 				PlayerPublisher->PublishPlayer(Controller->PlayerState, EPlayerProgress::InGame);
 			}
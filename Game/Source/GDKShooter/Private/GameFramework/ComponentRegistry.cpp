@@ -0,0 +1,141 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "ComponentRegistry.h"
+
+#include "Characters/Components/TeamComponent.h"
+#include "Controllers/Components/ControllerEventsComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("ComponentRegistryMisses"), STAT_GDKComponentRegistryMisses, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkComponentLookupCommand(
+	TEXT("GDK.BenchmarkComponentLookup"),
+	TEXT("Compares the component lookups of a damage event through GetComponentByClass and the component registry. Usage: GDK.BenchmarkComponentLookup [N]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FComponentRegistry::RunBenchmark));
+
+TMap<TWeakObjectPtr<const AActor>, FComponentRegistry::FActorComponents> FComponentRegistry::Actors;
+int32 FComponentRegistry::NumActorsAtLastPrune = 0;
+
+UActorComponent* FComponentRegistry::Get(const AActor* Actor, UClass* ComponentClass)
+{
+	if (Actor == nullptr)
+	{
+		return nullptr;
+	}
+
+	FActorComponents* ActorComponents = Actors.Find(Actor);
+	if (ActorComponents == nullptr)
+	{
+		// Actors are only dropped when destroyed, so prune whenever the map has doubled.
+		if (Actors.Num() >= FMath::Max(2 * NumActorsAtLastPrune, 64))
+		{
+			Prune();
+		}
+		ActorComponents = &Actors.Add(Actor);
+		ActorComponents->NumOwnedComponents = Actor->GetComponents().Num();
+	}
+	else if (ActorComponents->NumOwnedComponents != Actor->GetComponents().Num())
+	{
+		ActorComponents->Components.Reset();
+		ActorComponents->NumOwnedComponents = Actor->GetComponents().Num();
+	}
+
+	FCachedComponent* Cached = ActorComponents->Components.FindByPredicate([ComponentClass](const FCachedComponent& Entry)
+	{
+		return Entry.ComponentClass == ComponentClass;
+	});
+
+	if (Cached != nullptr)
+	{
+		if (!Cached->bFound)
+		{
+			return nullptr;
+		}
+
+		UActorComponent* Component = Cached->Component.Get();
+		if (Component != nullptr && Component->IsRegistered())
+		{
+			return Component;
+		}
+	}
+	else
+	{
+		Cached = &ActorComponents->Components.AddDefaulted_GetRef();
+		Cached->ComponentClass = ComponentClass;
+	}
+
+	INC_DWORD_STAT(STAT_GDKComponentRegistryMisses);
+	UActorComponent* Component = Actor->GetComponentByClass(ComponentClass);
+	Cached->Component = Component;
+	Cached->bFound = Component != nullptr;
+	return Component;
+}
+
+void FComponentRegistry::Prune()
+{
+	for (auto It = Actors.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	NumActorsAtLastPrune = Actors.Num();
+}
+
+void FComponentRegistry::RunBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	// A pawn with a team and a controller with controller events, as in a damage event.
+	APawn* Victim = nullptr;
+	for (TActorIterator<APawn> It(World); It; ++It)
+	{
+		if (It->GetController() != nullptr && It->GetComponentByClass(UTeamComponent::StaticClass()) != nullptr)
+		{
+			Victim = *It;
+			break;
+		}
+	}
+	if (Victim == nullptr)
+	{
+		UE_LOG(LogGDK, Warning, TEXT("GDK.BenchmarkComponentLookup: no controlled pawn with a team component in this world."));
+		return;
+	}
+
+	const int32 NumEvents = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+	AController* Controller = Victim->GetController();
+
+	// UHealthComponent::TakeDamage looks up the victim's team, the team check looks up the instigator's team,
+	// and a kill looks up the controller events of both controllers. Here the victim stands in for the instigator.
+	double StartTime = FPlatformTime::Seconds();
+	int32 Found = 0;
+	for (int32 Index = 0; Index < NumEvents; ++Index)
+	{
+		Found += Cast<UTeamComponent>(Victim->GetComponentByClass(UTeamComponent::StaticClass())) != nullptr ? 1 : 0;
+		Found += Cast<UTeamComponent>(Victim->GetComponentByClass(UTeamComponent::StaticClass())) != nullptr ? 1 : 0;
+		Found += Cast<UControllerEventsComponent>(Controller->GetComponentByClass(UControllerEventsComponent::StaticClass())) != nullptr ? 1 : 0;
+		Found += Cast<UControllerEventsComponent>(Controller->GetComponentByClass(UControllerEventsComponent::StaticClass())) != nullptr ? 1 : 0;
+	}
+	const double ByClassSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	int32 RegistryFound = 0;
+	for (int32 Index = 0; Index < NumEvents; ++Index)
+	{
+		RegistryFound += Get<UTeamComponent>(Victim) != nullptr ? 1 : 0;
+		RegistryFound += Get<UTeamComponent>(Victim) != nullptr ? 1 : 0;
+		RegistryFound += Get<UControllerEventsComponent>(Controller) != nullptr ? 1 : 0;
+		RegistryFound += Get<UControllerEventsComponent>(Controller) != nullptr ? 1 : 0;
+	}
+	const double RegistrySeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogGDK, Display, TEXT("GDK.BenchmarkComponentLookup: %d damage events, %d and %d components on the pawn and controller."),
+		NumEvents, Victim->GetComponents().Num(), Controller->GetComponents().Num());
+	UE_LOG(LogGDK, Display, TEXT("  GetComponentByClass: %8.1f ns per damage event (%d found)"), ByClassSeconds * 1.e9 / NumEvents, Found);
+	UE_LOG(LogGDK, Display, TEXT("  Component registry:  %8.1f ns per damage event (%d found)"), RegistrySeconds * 1.e9 / NumEvents, RegistryFound);
+}
@@ -0,0 +1,281 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CrossServerDamage.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_STAT(STAT_GDKLocalDamageHits);
+DEFINE_STAT(STAT_GDKCrossServerDamageHits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("CrossServerDamageRPCs"), STAT_GDKCrossServerDamageRPCs, STATGROUP_GDKShooter);
+
+namespace
+{
+	enum ECrossServerDamageFlags : uint8
+	{
+		// The lowest two bits hold the ECrossServerDamageType.
+		CrossServerDamageFlag_TypeMask = 0x3,
+		CrossServerDamageFlag_HasDamageType = 1 << 2,
+		CrossServerDamageFlag_HasInstigator = 1 << 3,
+		CrossServerDamageFlag_HasCauser = 1 << 4,
+		CrossServerDamageFlag_NumBits = 5
+	};
+
+	// Size of FCrossServerDamage as replicated property by property: damage, type, three vectors and the radius,
+	// excluding the references.
+	const int32 UnpackedCrossServerDamageBits = 32 + 8 + 3 * 3 * 32 + 32;
+
+	void MeasureCrossServerDamageWireSize(const TArray<FString>& Args, UWorld* World)
+	{
+		// Without references, so no package map is needed.
+		FCrossServerDamage Point;
+		Point.Damage = 25.0f;
+		Point.Type = ECrossServerDamageType::Point;
+		Point.Impact = FVector(12345.6f, -4321.9f, 250.3f);
+		Point.ShotDirection = FVector(0.6f, 0.8f, 0.0f);
+
+		FCrossServerDamage Radial;
+		Radial.Damage = 60.0f;
+		Radial.Type = ECrossServerDamageType::Radial;
+		Radial.Impact = FVector(12345.6f, -4321.9f, 250.3f);
+		Radial.Origin = FVector(12400.0f, -4300.0f, 200.0f);
+		Radial.Radius = 500.0f;
+
+		auto MeasureBits = [](FCrossServerDamage& Hit)
+		{
+			FNetBitWriter Writer(nullptr, 1024);
+			bool bSuccess = true;
+			Hit.NetSerialize(Writer, nullptr, bSuccess);
+			return Writer.GetNumBits();
+		};
+
+		UE_LOG(LogGDK, Display, TEXT("GDK.CrossServerDamageWireSize: point %lld bits, radial %lld bits (were %d), excluding references"),
+			MeasureBits(Point), MeasureBits(Radial), UnpackedCrossServerDamageBits);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CrossServerDamageWireSizeCommand(
+	TEXT("GDK.CrossServerDamageWireSize"),
+	TEXT("Logs the number of bits a cross-server hit takes on the wire, compared with property-by-property replication."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&MeasureCrossServerDamageWireSize));
+
+FCrossServerDamage::FCrossServerDamage(float InDamage, const FDamageEvent& DamageEvent, AController* InEventInstigator, AActor* InDamageCauser)
+	: FCrossServerDamage()
+{
+	Damage = InDamage;
+	DamageTypeClass = DamageEvent.DamageTypeClass;
+	EventInstigator = InEventInstigator;
+	DamageCauser = InDamageCauser;
+
+	if (DamageEvent.IsOfType(FPointDamageEvent::ClassID))
+	{
+		const FPointDamageEvent& PointDamageEvent = static_cast<const FPointDamageEvent&>(DamageEvent);
+		Type = ECrossServerDamageType::Point;
+		Impact = PointDamageEvent.HitInfo.ImpactPoint;
+		ShotDirection = PointDamageEvent.ShotDirection;
+	}
+	else if (DamageEvent.IsOfType(FRadialDamageEvent::ClassID))
+	{
+		const FRadialDamageEvent& RadialDamageEvent = static_cast<const FRadialDamageEvent&>(DamageEvent);
+		Type = ECrossServerDamageType::Radial;
+		Origin = RadialDamageEvent.Origin;
+		Impact = RadialDamageEvent.Origin;
+		Radius = RadialDamageEvent.Params.OuterRadius;
+
+		// The falloff AActor::InternalTakeRadialDamage would apply, from the closest hit on the victim.
+		float ClosestHitDistSq = MAX_flt;
+		for (const FHitResult& Hit : RadialDamageEvent.ComponentHits)
+		{
+			const float DistSq = (Hit.ImpactPoint - RadialDamageEvent.Origin).SizeSquared();
+			if (DistSq < ClosestHitDistSq)
+			{
+				ClosestHitDistSq = DistSq;
+				Impact = Hit.ImpactPoint;
+			}
+		}
+		const float DamageScale = RadialDamageEvent.Params.GetDamageScale(FMath::Sqrt(ClosestHitDistSq));
+		Damage = FMath::Lerp(RadialDamageEvent.Params.MinimumDamage, InDamage, FMath::Max(0.0f, DamageScale));
+	}
+}
+
+bool FCrossServerDamage::TryMerge(const FCrossServerDamage& Other)
+{
+	if (Type != Other.Type || DamageTypeClass != Other.DamageTypeClass || EventInstigator != Other.EventInstigator || DamageCauser != Other.DamageCauser)
+	{
+		return false;
+	}
+
+	// Explosions in different places come from different directions.
+	if (Type == ECrossServerDamageType::Radial && !Origin.Equals(Other.Origin))
+	{
+		return false;
+	}
+
+	Damage += Other.Damage;
+	Impact = Other.Impact;
+	ShotDirection = Other.ShotDirection;
+	return true;
+}
+
+void FCrossServerDamage::Dispatch(AActor* Victim, TFunctionRef<void(float Damage, const FDamageEvent& DamageEvent)> Receiver) const
+{
+	switch (Type)
+	{
+	case ECrossServerDamageType::Point:
+	{
+		FPointDamageEvent DamageEvent;
+		DamageEvent.DamageTypeClass = DamageTypeClass;
+		DamageEvent.ShotDirection = ShotDirection;
+		DamageEvent.HitInfo.Actor = Victim;
+		DamageEvent.HitInfo.Location = Impact;
+		DamageEvent.HitInfo.ImpactPoint = Impact;
+		Receiver(Damage, DamageEvent);
+		break;
+	}
+	case ECrossServerDamageType::Radial:
+	{
+		FHitResult Hit(Victim, Cast<UPrimitiveComponent>(Victim->GetRootComponent()), Impact, (Impact - Origin).GetSafeNormal());
+
+		FRadialDamageEvent DamageEvent;
+		DamageEvent.DamageTypeClass = DamageTypeClass;
+		DamageEvent.Origin = Origin;
+		// The falloff has already been applied, so make the receiving falloff a no-op.
+		DamageEvent.Params = FRadialDamageParams(Damage, Damage, 0.0f, Radius, 1.0f);
+		DamageEvent.ComponentHits.Add(Hit);
+		Receiver(Damage, DamageEvent);
+		break;
+	}
+	default:
+	{
+		FDamageEvent DamageEvent(DamageTypeClass);
+		Receiver(Damage, DamageEvent);
+		break;
+	}
+	}
+}
+
+bool FCrossServerDamage::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Flags = 0;
+	if (Ar.IsSaving())
+	{
+		Flags |= static_cast<uint8>(Type) & CrossServerDamageFlag_TypeMask;
+		Flags |= DamageTypeClass != nullptr ? CrossServerDamageFlag_HasDamageType : 0;
+		Flags |= EventInstigator != nullptr ? CrossServerDamageFlag_HasInstigator : 0;
+		Flags |= DamageCauser != nullptr ? CrossServerDamageFlag_HasCauser : 0;
+	}
+	Ar.SerializeBits(&Flags, CrossServerDamageFlag_NumBits);
+
+	const ECrossServerDamageType SerializedType = static_cast<ECrossServerDamageType>(Flags & CrossServerDamageFlag_TypeMask);
+
+	Ar << Damage;
+
+	if (SerializedType != ECrossServerDamageType::Generic)
+	{
+		SerializePackedVector<10, 24>(Impact, Ar);
+	}
+
+	if (SerializedType == ECrossServerDamageType::Point)
+	{
+		SerializeFixedVector<1, 16>(ShotDirection, Ar);
+	}
+	else if (SerializedType == ECrossServerDamageType::Radial)
+	{
+		SerializePackedVector<10, 24>(Origin, Ar);
+
+		uint32 PackedRadius = Ar.IsSaving() ? static_cast<uint32>(FMath::RoundToInt(FMath::Max(Radius, 0.0f))) : 0;
+		Ar.SerializeIntPacked(PackedRadius);
+		Radius = static_cast<float>(PackedRadius);
+	}
+
+	UObject* DamageTypeObject = DamageTypeClass;
+	if (Flags & CrossServerDamageFlag_HasDamageType)
+	{
+		Ar << DamageTypeObject;
+	}
+
+	UObject* InstigatorObject = EventInstigator;
+	if (Flags & CrossServerDamageFlag_HasInstigator)
+	{
+		Ar << InstigatorObject;
+	}
+
+	UObject* CauserObject = DamageCauser;
+	if (Flags & CrossServerDamageFlag_HasCauser)
+	{
+		Ar << CauserObject;
+	}
+
+	if (Ar.IsLoading())
+	{
+		Type = SerializedType;
+		DamageTypeClass = (Flags & CrossServerDamageFlag_HasDamageType) ? Cast<UClass>(DamageTypeObject) : nullptr;
+		EventInstigator = (Flags & CrossServerDamageFlag_HasInstigator) ? Cast<AController>(InstigatorObject) : nullptr;
+		DamageCauser = (Flags & CrossServerDamageFlag_HasCauser) ? Cast<AActor>(CauserObject) : nullptr;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+ACrossServerDamageQueue::ACrossServerDamageQueue()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// After gameplay has dealt this frame's damage.
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+}
+
+void ACrossServerDamageQueue::Add(AActor* Victim, const FCrossServerDamage& Hit, const FSendCrossServerDamage& Send)
+{
+	INC_DWORD_STAT(STAT_GDKCrossServerDamageHits);
+
+	if (const int32* Index = PendingIndices.Find(Victim))
+	{
+		TArray<FCrossServerDamage>& Hits = Pending[*Index].Hits;
+		for (FCrossServerDamage& Existing : Hits)
+		{
+			if (Existing.TryMerge(Hit))
+			{
+				return;
+			}
+		}
+		Hits.Add(Hit);
+		return;
+	}
+
+	PendingIndices.Add(Victim, Pending.Num());
+	FPendingDamage& Entry = Pending.AddDefaulted_GetRef();
+	Entry.Victim = Victim;
+	Entry.Send = Send;
+	Entry.Hits.Add(Hit);
+	SetActorTickEnabled(true);
+}
+
+void ACrossServerDamageQueue::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Sending can apply damage straight away on this server, which may queue more.
+	TArray<FPendingDamage> ToSend = MoveTemp(Pending);
+	Pending.Reset();
+	PendingIndices.Reset();
+
+	for (FPendingDamage& Entry : ToSend)
+	{
+		if (Entry.Victim.IsValid())
+		{
+			INC_DWORD_STAT(STAT_GDKCrossServerDamageRPCs);
+			Entry.Send.ExecuteIfBound(Entry.Hits);
+		}
+	}
+
+	if (Pending.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
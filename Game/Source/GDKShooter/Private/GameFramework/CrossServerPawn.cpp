@@ -2,13 +2,67 @@
 
 #include "CrossServerPawn.h"
 
+#include "GameFramework/DamageableGrid.h"
+#include "GDKStats.h"
+
+void ACrossServerPawn::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Only servers apply radial damage.
+	if (GetNetMode() != NM_Client)
+	{
+		if (ADamageableGrid* DamageableGrid = AGDKWorldManager::Get<ADamageableGrid>(this))
+		{
+			DamageableGrid->Register(this);
+		}
+	}
+}
+
+void ACrossServerPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ADamageableGrid* DamageableGrid = AGDKWorldManager::Find<ADamageableGrid>(this))
+	{
+		DamageableGrid->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 float ACrossServerPawn::TakeDamage(float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	TakeDamageCrossServer(Damage, DamageEvent, nullptr, DamageCauser);
+	// Damage from this server's own actors is applied straight away.
+	if (HasAuthority())
+	{
+		INC_DWORD_STAT(STAT_GDKLocalDamageHits);
+		ApplyDamage(Damage, DamageEvent, nullptr, DamageCauser);
+		return Damage;
+	}
+
+	if (DamageQueue == nullptr)
+	{
+		DamageQueue = AGDKWorldManager::Get<ACrossServerDamageQueue>(this);
+	}
+	if (DamageQueue != nullptr)
+	{
+		DamageQueue->Add(this, FCrossServerDamage(Damage, DamageEvent, nullptr, DamageCauser),
+			FSendCrossServerDamage::CreateUObject(this, &ACrossServerPawn::TakeDamageCrossServer));
+	}
 	return Damage;
 }
 
-void ACrossServerPawn::TakeDamageCrossServer_Implementation(float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+void ACrossServerPawn::TakeDamageCrossServer_Implementation(const TArray<FCrossServerDamage>& Hits)
+{
+	for (const FCrossServerDamage& Hit : Hits)
+	{
+		Hit.Dispatch(this, [this, &Hit](float Damage, const FDamageEvent& DamageEvent)
+		{
+			ApplyDamage(Damage, DamageEvent, Hit.EventInstigator, Hit.DamageCauser);
+		});
+	}
+}
+
+void ACrossServerPawn::ApplyDamage(float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
 	float ActualDamage = Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
 	IncomingDamage.Broadcast(ActualDamage, DamageEvent, EventInstigator, DamageCauser);
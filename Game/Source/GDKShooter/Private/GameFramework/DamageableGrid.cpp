@@ -0,0 +1,357 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "DamageableGrid.h"
+
+#include "CollisionQueryParams.h"
+#include "Components/SphereComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/Controller.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("DamageableGridGather"), STAT_GDKDamageableGridGather, STATGROUP_GDKShooter);
+DECLARE_CYCLE_STAT(TEXT("DamageableGridOverlap"), STAT_GDKDamageableGridOverlap, STATGROUP_GDKShooter);
+DECLARE_CYCLE_STAT(TEXT("DamageableGridTraces"), STAT_GDKDamageableGridTraces, STATGROUP_GDKShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("DamageableActors"), STAT_GDKDamageableActors, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkExplosionsCommand(
+	TEXT("GDK.BenchmarkExplosions"),
+	TEXT("Compares finding explosion victims through the damageable grid and the physics scene. Usage: GDK.BenchmarkExplosions [CrowdSize...]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ADamageableGrid::RunBenchmark));
+
+ADamageableGrid::ADamageableGrid()
+	: CellSize(1000.0f)
+	, bDamageUnregisteredActors(true)
+	, MaxBoundsRadius(0.0f)
+{
+}
+
+FIntPoint ADamageableGrid::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void ADamageableGrid::AddToCell(const FIntPoint& Cell, int32 EntryIndex)
+{
+	Cells.FindOrAdd(Cell).Add(EntryIndex);
+}
+
+void ADamageableGrid::RemoveFromCell(const FIntPoint& Cell, int32 EntryIndex)
+{
+	TArray<int32>* CellEntries = Cells.Find(Cell);
+	if (CellEntries == nullptr)
+	{
+		return;
+	}
+
+	CellEntries->RemoveSingleSwap(EntryIndex, false);
+	if (CellEntries->Num() == 0)
+	{
+		Cells.Remove(Cell);
+	}
+}
+
+void ADamageableGrid::Register(AActor* Actor)
+{
+	USceneComponent* Root = Actor != nullptr ? Actor->GetRootComponent() : nullptr;
+	if (Root == nullptr || EntryIndices.Contains(Root))
+	{
+		return;
+	}
+
+	const int32 EntryIndex = Entries.AddDefaulted();
+	FDamageableEntry& Entry = Entries[EntryIndex];
+	Entry.Actor = Actor;
+	Entry.Root = Root;
+	Entry.Cell = GetCell(Root->GetComponentLocation());
+	Entry.TransformUpdatedHandle = Root->TransformUpdated.AddUObject(this, &ADamageableGrid::OnTransformUpdated);
+
+	EntryIndices.Add(Root, EntryIndex);
+	AddToCell(Entry.Cell, EntryIndex);
+	MaxBoundsRadius = FMath::Max(MaxBoundsRadius, Root->Bounds.SphereRadius);
+	INC_DWORD_STAT(STAT_GDKDamageableActors);
+}
+
+void ADamageableGrid::Unregister(AActor* Actor)
+{
+	USceneComponent* Root = Actor != nullptr ? Actor->GetRootComponent() : nullptr;
+	int32 EntryIndex;
+	if (Root == nullptr || !EntryIndices.RemoveAndCopyValue(Root, EntryIndex))
+	{
+		return;
+	}
+
+	Root->TransformUpdated.Remove(Entries[EntryIndex].TransformUpdatedHandle);
+	RemoveFromCell(Entries[EntryIndex].Cell, EntryIndex);
+
+	// Move the last entry into the freed slot.
+	const int32 LastIndex = Entries.Num() - 1;
+	if (EntryIndex != LastIndex)
+	{
+		FDamageableEntry& Last = Entries[LastIndex];
+		TArray<int32>& LastCellEntries = Cells.FindChecked(Last.Cell);
+		LastCellEntries[LastCellEntries.IndexOfByKey(LastIndex)] = EntryIndex;
+		EntryIndices.Add(Last.Root.Get(), EntryIndex);
+	}
+	Entries.RemoveAtSwap(EntryIndex, 1, false);
+	DEC_DWORD_STAT(STAT_GDKDamageableActors);
+}
+
+void ADamageableGrid::OnTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	const int32* EntryIndex = EntryIndices.Find(Component);
+	if (EntryIndex == nullptr)
+	{
+		return;
+	}
+
+	FDamageableEntry& Entry = Entries[*EntryIndex];
+	const FIntPoint Cell = GetCell(Component->GetComponentLocation());
+	if (Cell != Entry.Cell)
+	{
+		RemoveFromCell(Entry.Cell, *EntryIndex);
+		AddToCell(Cell, *EntryIndex);
+		Entry.Cell = Cell;
+	}
+}
+
+void ADamageableGrid::GatherCandidates(const FVector& Origin, float Radius, const TArray<AActor*>& IgnoreActors, TArray<FDamageableCandidate>& OutCandidates) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKDamageableGridGather);
+
+	const float RadiusSq = FMath::Square(Radius);
+	const FIntPoint MinCell = GetCell(Origin - FVector(Radius + MaxBoundsRadius));
+	const FIntPoint MaxCell = GetCell(Origin + FVector(Radius + MaxBoundsRadius));
+
+	for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+	{
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			const TArray<int32>* CellEntries = Cells.Find(FIntPoint(CellX, CellY));
+			if (CellEntries == nullptr)
+			{
+				continue;
+			}
+
+			for (int32 EntryIndex : *CellEntries)
+			{
+				const FDamageableEntry& Entry = Entries[EntryIndex];
+				AActor* Actor = Entry.Actor.Get();
+				USceneComponent* Root = Entry.Root.Get();
+				if (Actor == nullptr || Root == nullptr || !Actor->bCanBeDamaged || IgnoreActors.Contains(Actor))
+				{
+					continue;
+				}
+
+				const FVector ClosestPoint = Root->Bounds.GetBox().GetClosestPointTo(Origin);
+				if (FVector::DistSquared(ClosestPoint, Origin) <= RadiusSq)
+				{
+					OutCandidates.Add({ Actor, Root, ClosestPoint });
+				}
+			}
+		}
+	}
+}
+
+void ADamageableGrid::GatherUnregisteredCandidates(const FVector& Origin, float Radius, const TArray<AActor*>& IgnoreActors, TArray<FDamageableCandidate>& InOutCandidates) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKDamageableGridOverlap);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(GDKRadialDamage), false);
+	Params.AddIgnoredActors(IgnoreActors);
+
+	TArray<FOverlapResult> Overlaps;
+	GetWorld()->OverlapMultiByObjectType(Overlaps, Origin, FQuat::Identity, FCollisionObjectQueryParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects),
+		FCollisionShape::MakeSphere(Radius), Params);
+
+	const int32 FirstUnregistered = InOutCandidates.Num();
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		AActor* Actor = Overlap.GetActor();
+		UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (Actor == nullptr || Component == nullptr || !Actor->bCanBeDamaged || EntryIndices.Contains(Actor->GetRootComponent()))
+		{
+			continue;
+		}
+
+		// Actors are damaged once, through the first of their components found.
+		bool bAlreadyFound = false;
+		for (int32 Index = FirstUnregistered; Index < InOutCandidates.Num() && !bAlreadyFound; ++Index)
+		{
+			bAlreadyFound = InOutCandidates[Index].Actor == Actor;
+		}
+		if (!bAlreadyFound)
+		{
+			InOutCandidates.Add({ Actor, Component, Component->Bounds.GetBox().GetClosestPointTo(Origin) });
+		}
+	}
+}
+
+void ADamageableGrid::FilterVisibleCandidates(const FVector& Origin, const TArray<AActor*>& IgnoreActors, ECollisionChannel TraceChannel, TArray<FDamageableCandidate>& InOutCandidates) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKDamageableGridTraces);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(GDKRadialDamage), false);
+	Params.AddIgnoredActors(IgnoreActors);
+
+	// Like the engine's radial damage, trace to the centre of the victim's bounds and ignore the victim itself.
+	for (int32 Index = InOutCandidates.Num() - 1; Index >= 0; --Index)
+	{
+		const FDamageableCandidate& Candidate = InOutCandidates[Index];
+		FCollisionQueryParams CandidateParams = Params;
+		CandidateParams.AddIgnoredActor(Candidate.Actor);
+		if (GetWorld()->LineTraceTestByChannel(Origin, Candidate.Root->Bounds.Origin, TraceChannel, CandidateParams))
+		{
+			InOutCandidates.RemoveAtSwap(Index, 1, false);
+		}
+	}
+}
+
+void ADamageableGrid::GatherActorsInRadius(const FVector& Origin, float Radius, TArray<AActor*>& OutActors) const
+{
+	TArray<FDamageableCandidate> Candidates;
+	GatherCandidates(Origin, Radius, TArray<AActor*>(), Candidates);
+	for (const FDamageableCandidate& Candidate : Candidates)
+	{
+		OutActors.Add(Candidate.Actor);
+	}
+}
+
+bool ADamageableGrid::ApplyRadialDamageWithFalloff(float BaseDamage, float MinimumDamage, const FVector& Origin, float DamageInnerRadius, float DamageOuterRadius,
+	float DamageFalloff, TSubclassOf<UDamageType> DamageTypeClass, const TArray<AActor*>& IgnoreActors, AActor* DamageCauser,
+	AController* InstigatedByController, ECollisionChannel DamagePreventionChannel)
+{
+	TArray<FDamageableCandidate> Candidates;
+	GatherCandidates(Origin, DamageOuterRadius, IgnoreActors, Candidates);
+	if (bDamageUnregisteredActors)
+	{
+		GatherUnregisteredCandidates(Origin, DamageOuterRadius, IgnoreActors, Candidates);
+	}
+	FilterVisibleCandidates(Origin, IgnoreActors, DamagePreventionChannel, Candidates);
+
+	if (Candidates.Num() == 0)
+	{
+		return false;
+	}
+
+	FRadialDamageEvent DamageEvent;
+	DamageEvent.DamageTypeClass = DamageTypeClass != nullptr ? DamageTypeClass : TSubclassOf<UDamageType>(UDamageType::StaticClass());
+	DamageEvent.Origin = Origin;
+	DamageEvent.Params = FRadialDamageParams(BaseDamage, MinimumDamage, DamageInnerRadius, DamageOuterRadius, DamageFalloff);
+
+	// Damage is applied once all traces are done, so victims destroyed by it don't affect the others.
+	for (const FDamageableCandidate& Candidate : Candidates)
+	{
+		// The damage falloff is measured to the impact point.
+		FHitResult Hit(Candidate.Actor, Cast<UPrimitiveComponent>(Candidate.Root), Candidate.ClosestPoint, (Candidate.ClosestPoint - Origin).GetSafeNormal());
+		Hit.ImpactPoint = Candidate.ClosestPoint;
+		DamageEvent.ComponentHits.Reset();
+		DamageEvent.ComponentHits.Add(Hit);
+
+		Candidate.Actor->TakeDamage(BaseDamage, DamageEvent, InstigatedByController, DamageCauser);
+	}
+	return true;
+}
+
+void ADamageableGrid::RunBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	ADamageableGrid* Grid = AGDKWorldManager::Get<ADamageableGrid>(World);
+	if (Grid == nullptr)
+	{
+		UE_LOG(LogGDK, Warning, TEXT("GDK.BenchmarkExplosions: no game world to benchmark in."));
+		return;
+	}
+
+	TArray<int32> CrowdSizes;
+	for (const FString& Arg : Args)
+	{
+		CrowdSizes.Add(FMath::Max(1, FCString::Atoi(*Arg)));
+	}
+	if (CrowdSizes.Num() == 0)
+	{
+		CrowdSizes = { 10, 100, 1000 };
+	}
+
+	const int32 NumExplosions = 1000;
+	const float ExplosionRadius = 500.0f;
+	const float CrowdHeight = 10000.0f;
+
+	for (int32 CrowdSize : CrowdSizes)
+	{
+		// Keep the density of the crowd constant, about one actor per 10m square, high above the level.
+		const float HalfWidth = FMath::Sqrt(static_cast<float>(CrowdSize)) * 500.0f;
+		FRandomStream Random(CrowdSize);
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		TArray<AActor*> Crowd;
+		for (int32 Index = 0; Index < CrowdSize; ++Index)
+		{
+			const FVector Location(Random.FRandRange(-HalfWidth, HalfWidth), Random.FRandRange(-HalfWidth, HalfWidth), CrowdHeight);
+			AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform(Location), SpawnParameters);
+			USphereComponent* Sphere = NewObject<USphereComponent>(Actor);
+			Sphere->InitSphereRadius(50.0f);
+			Sphere->SetCollisionProfileName(UCollisionProfile::Pawn_ProfileName);
+			Actor->SetRootComponent(Sphere);
+			Sphere->SetWorldLocation(Location);
+			Sphere->RegisterComponent();
+			Grid->Register(Actor);
+			Crowd.Add(Actor);
+		}
+
+		TArray<FVector> Origins;
+		for (int32 Index = 0; Index < NumExplosions; ++Index)
+		{
+			Origins.Add(FVector(Random.FRandRange(-HalfWidth, HalfWidth), Random.FRandRange(-HalfWidth, HalfWidth), CrowdHeight));
+		}
+
+		// What UGameplayStatics::ApplyRadialDamageWithFalloff does: overlap dynamic objects, then trace to each component.
+		double StartTime = FPlatformTime::Seconds();
+		int32 PhysicsVictims = 0;
+		for (const FVector& Origin : Origins)
+		{
+			FCollisionQueryParams Params(SCENE_QUERY_STAT(GDKExplosionBenchmark), false);
+			TArray<FOverlapResult> Overlaps;
+			World->OverlapMultiByObjectType(Overlaps, Origin, FQuat::Identity, FCollisionObjectQueryParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects),
+				FCollisionShape::MakeSphere(ExplosionRadius), Params);
+			for (const FOverlapResult& Overlap : Overlaps)
+			{
+				UPrimitiveComponent* Component = Overlap.GetComponent();
+				if (Component == nullptr)
+				{
+					continue;
+				}
+				FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(GDKExplosionBenchmark), false, Overlap.GetActor());
+				FHitResult Hit;
+				PhysicsVictims += World->LineTraceSingleByChannel(Hit, Origin, Component->Bounds.Origin, ECC_Visibility, TraceParams) ? 0 : 1;
+			}
+		}
+		const double PhysicsSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		int32 GridVictims = 0;
+		for (const FVector& Origin : Origins)
+		{
+			TArray<FDamageableCandidate> Candidates;
+			Grid->GatherCandidates(Origin, ExplosionRadius, TArray<AActor*>(), Candidates);
+			Grid->FilterVisibleCandidates(Origin, TArray<AActor*>(), ECC_Visibility, Candidates);
+			GridVictims += Candidates.Num();
+		}
+		const double GridSeconds = FPlatformTime::Seconds() - StartTime;
+
+		for (AActor* Actor : Crowd)
+		{
+			Grid->Unregister(Actor);
+			Actor->Destroy();
+		}
+
+		UE_LOG(LogGDK, Display, TEXT("GDK.BenchmarkExplosions: crowd of %d, %d explosions."), CrowdSize, NumExplosions);
+		UE_LOG(LogGDK, Display, TEXT("  Physics overlap and traces: %8.3f us per explosion (%d victims)"), PhysicsSeconds * 1.e6 / NumExplosions, PhysicsVictims);
+		UE_LOG(LogGDK, Display, TEXT("  Damageable grid and traces: %8.3f us per explosion (%d victims)"), GridSeconds * 1.e6 / NumExplosions, GridVictims);
+	}
+}
@@ -0,0 +1,11 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "GDKWorldManager.h"
+
+AGDKWorldManager::AGDKWorldManager()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// Every worker keeps its own instance.
+	bReplicates = false;
+}
@@ -0,0 +1,236 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "MovementNetLOD.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GDKStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("MovementNetLODPass"), STAT_GDKMovementNetLODPass, STATGROUP_GDKShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("MovementNetLODReduced"), STAT_GDKMovementNetLODReduced, STATGROUP_GDKShooter);
+
+AMovementNetLOD::AMovementNetLOD()
+	: UpdateInterval(0.25f)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	// Full rate within 25m, then coarser out to 150m, and a trickle beyond.
+	FMovementNetLODTier Near;
+	Near.MaxDistance = 2500.0f;
+	Tiers.Add(Near);
+
+	FMovementNetLODTier Medium;
+	Medium.MaxDistance = 6000.0f;
+	Medium.MaxNetUpdateFrequency = 30.0f;
+	Medium.SmoothTimeScale = 1.5f;
+	Tiers.Add(Medium);
+
+	FMovementNetLODTier Far;
+	Far.MaxDistance = 15000.0f;
+	Far.MaxNetUpdateFrequency = 12.0f;
+	Far.SmoothTimeScale = 2.5f;
+	Far.SmoothDistanceScale = 1.5f;
+	Tiers.Add(Far);
+
+	FMovementNetLODTier Distant;
+	Distant.MaxNetUpdateFrequency = 5.0f;
+	Distant.SmoothTimeScale = 4.0f;
+	Distant.SmoothDistanceScale = 2.0f;
+	Tiers.Add(Distant);
+}
+
+void AMovementNetLOD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetActorTickInterval(UpdateInterval);
+}
+
+void AMovementNetLOD::Register(ACharacter* Character)
+{
+	FLODEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Character = Character;
+	Entry.Tier = INDEX_NONE;
+	SetActorTickEnabled(true);
+}
+
+void AMovementNetLOD::Unregister(ACharacter* Character)
+{
+	const int32 Index = Entries.IndexOfByPredicate([Character](const FLODEntry& Entry)
+	{
+		return Entry.Character == Character;
+	});
+	if (Index != INDEX_NONE)
+	{
+		Entries.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+int32 AMovementNetLOD::GetTier(float Distance) const
+{
+	for (int32 Index = 0; Index < Tiers.Num() - 1; ++Index)
+	{
+		if (Distance <= Tiers[Index].MaxDistance)
+		{
+			return Index;
+		}
+	}
+	return Tiers.Num() - 1;
+}
+
+void AMovementNetLOD::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_GDKMovementNetLODPass);
+
+	Entries.RemoveAllSwap([](const FLODEntry& Entry)
+	{
+		return !Entry.Character.IsValid();
+	}, false);
+
+	if (Entries.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+	if (Tiers.Num() == 0)
+	{
+		return;
+	}
+
+	if (GetNetMode() == NM_Client)
+	{
+		UpdateClientTiers();
+	}
+	else
+	{
+		UpdateServerTiers();
+	}
+}
+
+void AMovementNetLOD::UpdateServerTiers()
+{
+	// The players' characters stand in for their viewpoints, since their controllers may be on another server.
+	Viewers.Reset();
+	for (const FLODEntry& Entry : Entries)
+	{
+		ACharacter* Character = Entry.Character.Get();
+		if (Character->PlayerState != nullptr && !Character->PlayerState->bIsABot)
+		{
+			Viewers.Emplace(Character, Character->GetActorLocation());
+		}
+	}
+
+	int32 NumReduced = 0;
+	for (FLODEntry& Entry : Entries)
+	{
+		ACharacter* Character = Entry.Character.Get();
+		if (!Character->HasAuthority())
+		{
+			// The server that takes the character over starts from its default rate, so reapply the tier if it comes back.
+			Entry.Tier = INDEX_NONE;
+			continue;
+		}
+
+		// The owner gets its corrections separately, so it doesn't count as a viewer.
+		const FVector Location = Character->GetActorLocation();
+		float ClosestDistSq = MAX_flt;
+		for (const TPair<ACharacter*, FVector>& Viewer : Viewers)
+		{
+			if (Viewer.Key != Character)
+			{
+				ClosestDistSq = FMath::Min(ClosestDistSq, FVector::DistSquared(Location, Viewer.Value));
+			}
+		}
+
+		const int32 Tier = GetTier(FMath::Sqrt(ClosestDistSq));
+		if (Tier != Entry.Tier)
+		{
+			Entry.Tier = Tier;
+			ApplyServerTier(Character, Tiers[Tier]);
+		}
+		NumReduced += Tier > 0 ? 1 : 0;
+	}
+
+	SET_DWORD_STAT(STAT_GDKMovementNetLODReduced, NumReduced);
+}
+
+void AMovementNetLOD::UpdateClientTiers()
+{
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController == nullptr)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	int32 NumReduced = 0;
+	for (FLODEntry& Entry : Entries)
+	{
+		ACharacter* Character = Entry.Character.Get();
+		if (Character->Role != ROLE_SimulatedProxy)
+		{
+			continue;
+		}
+
+		const int32 Tier = GetTier(FVector::Dist(ViewLocation, Character->GetActorLocation()));
+		if (Tier != Entry.Tier)
+		{
+			Entry.Tier = Tier;
+			ApplyClientTier(Character, Tiers[Tier]);
+		}
+		NumReduced += Tier > 0 ? 1 : 0;
+	}
+
+	SET_DWORD_STAT(STAT_GDKMovementNetLODReduced, NumReduced);
+}
+
+void AMovementNetLOD::ApplyServerTier(ACharacter* Character, const FMovementNetLODTier& Tier) const
+{
+	const ACharacter* Defaults = Character->GetClass()->GetDefaultObject<ACharacter>();
+	Character->NetUpdateFrequency = FMath::Min(Defaults->NetUpdateFrequency, Tier.MaxNetUpdateFrequency);
+	Character->MinNetUpdateFrequency = FMath::Min(Defaults->MinNetUpdateFrequency, Character->NetUpdateFrequency);
+
+	Character->ReplicatedMovement.LocationQuantizationLevel = Tier.LocationQuantization;
+	Character->ReplicatedMovement.VelocityQuantizationLevel = Tier.VelocityQuantization;
+	Character->ReplicatedMovement.RotationQuantizationLevel = Tier.RotationQuantization;
+}
+
+void AMovementNetLOD::ApplyClientTier(ACharacter* Character, const FMovementNetLODTier& Tier) const
+{
+	UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	if (Movement == nullptr)
+	{
+		return;
+	}
+
+	// Tiers scale the class's own smoothing, so characters tuned for it keep their tuning up close.
+	const UCharacterMovementComponent* Defaults = Character->GetClass()->GetDefaultObject<ACharacter>()->GetCharacterMovement();
+	if (Defaults == nullptr)
+	{
+		return;
+	}
+
+	Movement->NetworkSimulatedSmoothLocationTime = Defaults->NetworkSimulatedSmoothLocationTime * Tier.SmoothTimeScale;
+	Movement->NetworkSimulatedSmoothRotationTime = Defaults->NetworkSimulatedSmoothRotationTime * Tier.SmoothTimeScale;
+	Movement->NetworkMaxSmoothUpdateDistance = Defaults->NetworkMaxSmoothUpdateDistance * Tier.SmoothDistanceScale;
+	Movement->NetworkNoSmoothUpdateDistance = Defaults->NetworkNoSmoothUpdateDistance * Tier.SmoothDistanceScale;
+
+	// The prediction data copies the settings when it's created.
+	if (Movement->HasPredictionData_Client())
+	{
+		FNetworkPredictionData_Client_Character* ClientData = Movement->GetPredictionData_Client_Character();
+		ClientData->SmoothNetUpdateTime = Movement->NetworkSimulatedSmoothLocationTime;
+		ClientData->SmoothNetUpdateRotationTime = Movement->NetworkSimulatedSmoothRotationTime;
+		ClientData->MaxSmoothNetUpdateDist = Movement->NetworkMaxSmoothUpdateDistance;
+		ClientData->NoSmoothNetUpdateDist = Movement->NetworkNoSmoothUpdateDistance;
+	}
+}
@@ -0,0 +1,277 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "TimerWheel.h"
+
+#include "Engine/World.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("TimerWheelAdvance"), STAT_GDKTimerWheelAdvance, STATGROUP_GDKShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("TimerWheelPending"), STAT_GDKTimerWheelPending, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkTimerWheelCommand(
+	TEXT("GDK.BenchmarkTimerWheel"),
+	TEXT("Times adding, cancelling and firing N timers on the timer wheel. Usage: GDK.BenchmarkTimerWheel [N]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ATimerWheelManager::RunBenchmark));
+
+FGDKTimerWheel::FGDKTimerWheel()
+	: FreeHead(INDEX_NONE)
+	, NumTimers(0)
+	, CurrentTick(0)
+{
+	for (int32& Head : BucketHeads)
+	{
+		Head = INDEX_NONE;
+	}
+}
+
+FTimerWheelHandle FGDKTimerWheel::Add(uint64 ExpiryTick, const FSimpleDelegate& Delegate)
+{
+	int32 NodeIndex = FreeHead;
+	if (NodeIndex != INDEX_NONE)
+	{
+		FreeHead = Nodes[NodeIndex].Next;
+	}
+	else
+	{
+		NodeIndex = Nodes.AddDefaulted();
+		Nodes[NodeIndex].Serial = 0;
+	}
+
+	FTimerNode& Node = Nodes[NodeIndex];
+	Node.Delegate = Delegate;
+	// The current tick's slot has already fired.
+	Node.ExpiryTick = FMath::Max(ExpiryTick, CurrentTick + 1);
+	Place(NodeIndex);
+	++NumTimers;
+
+	FTimerWheelHandle Handle;
+	Handle.Index = NodeIndex;
+	Handle.Serial = Node.Serial;
+	return Handle;
+}
+
+void FGDKTimerWheel::Cancel(FTimerWheelHandle& Handle)
+{
+	if (Nodes.IsValidIndex(Handle.Index))
+	{
+		FTimerNode& Node = Nodes[Handle.Index];
+		if (Node.Serial == Handle.Serial && Node.Bucket != INDEX_NONE)
+		{
+			Unlink(Handle.Index);
+			Free(Handle.Index);
+			--NumTimers;
+		}
+	}
+	Handle.Invalidate();
+}
+
+void FGDKTimerWheel::Place(int32 NodeIndex)
+{
+	const uint64 ExpiryTick = Nodes[NodeIndex].ExpiryTick;
+	if (ExpiryTick <= CurrentTick)
+	{
+		Link(NodeIndex, static_cast<int32>(CurrentTick & (NumSlots - 1)));
+		return;
+	}
+
+	// The lowest level whose range covers the delay. Timers beyond the top level wait in its furthest slot and are placed again.
+	const uint64 Delay = ExpiryTick - CurrentTick;
+	int32 Level = 0;
+	while (Level < NumLevels - 1 && Delay >= (uint64(1) << (SlotBits * (Level + 1))))
+	{
+		++Level;
+	}
+	const uint64 MaxDelay = (uint64(1) << (SlotBits * NumLevels)) - 1;
+	const uint64 PlacedTick = Delay > MaxDelay ? CurrentTick + MaxDelay : ExpiryTick;
+	const int32 Slot = static_cast<int32>((PlacedTick >> (SlotBits * Level)) & (NumSlots - 1));
+	Link(NodeIndex, Level * NumSlots + Slot);
+}
+
+void FGDKTimerWheel::Link(int32 NodeIndex, int32 Bucket)
+{
+	FTimerNode& Node = Nodes[NodeIndex];
+	Node.Bucket = Bucket;
+	Node.Prev = INDEX_NONE;
+	Node.Next = BucketHeads[Bucket];
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = NodeIndex;
+	}
+	BucketHeads[Bucket] = NodeIndex;
+}
+
+void FGDKTimerWheel::Unlink(int32 NodeIndex)
+{
+	FTimerNode& Node = Nodes[NodeIndex];
+	if (Node.Prev != INDEX_NONE)
+	{
+		Nodes[Node.Prev].Next = Node.Next;
+	}
+	else
+	{
+		BucketHeads[Node.Bucket] = Node.Next;
+	}
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Node.Prev;
+	}
+	Node.Bucket = INDEX_NONE;
+}
+
+void FGDKTimerWheel::Free(int32 NodeIndex)
+{
+	FTimerNode& Node = Nodes[NodeIndex];
+	Node.Delegate.Unbind();
+	Node.Bucket = INDEX_NONE;
+	++Node.Serial;
+	Node.Next = FreeHead;
+	FreeHead = NodeIndex;
+}
+
+void FGDKTimerWheel::Cascade(int32 Level)
+{
+	const int32 Bucket = Level * NumSlots + static_cast<int32>((CurrentTick >> (SlotBits * Level)) & (NumSlots - 1));
+	int32 NodeIndex = BucketHeads[Bucket];
+	BucketHeads[Bucket] = INDEX_NONE;
+	while (NodeIndex != INDEX_NONE)
+	{
+		const int32 Next = Nodes[NodeIndex].Next;
+		Place(NodeIndex);
+		NodeIndex = Next;
+	}
+}
+
+void FGDKTimerWheel::Advance(uint64 Tick)
+{
+	while (CurrentTick < Tick)
+	{
+		// Nothing to fire on the way, so skip straight there.
+		if (NumTimers == 0)
+		{
+			CurrentTick = Tick;
+			return;
+		}
+
+		++CurrentTick;
+
+		// Move timers down from upper levels whose slot starts at this tick, top level first.
+		for (int32 Level = NumLevels - 1; Level > 0; --Level)
+		{
+			if ((CurrentTick & ((uint64(1) << (SlotBits * Level)) - 1)) == 0)
+			{
+				Cascade(Level);
+			}
+		}
+
+		const int32 Bucket = static_cast<int32>(CurrentTick & (NumSlots - 1));
+		int32 NodeIndex = BucketHeads[Bucket];
+		BucketHeads[Bucket] = INDEX_NONE;
+		while (NodeIndex != INDEX_NONE)
+		{
+			const int32 Next = Nodes[NodeIndex].Next;
+			Expired.Add(MoveTemp(Nodes[NodeIndex].Delegate));
+			Free(NodeIndex);
+			--NumTimers;
+			NodeIndex = Next;
+		}
+
+		// Fire after unlinking, so delegates can add and cancel timers.
+		for (FSimpleDelegate& Delegate : Expired)
+		{
+			Delegate.ExecuteIfBound();
+		}
+		Expired.Reset();
+	}
+}
+
+const float ATimerWheelManager::Resolution = 1.0f / 30.0f;
+
+ATimerWheelManager::ATimerWheelManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+uint64 ATimerWheelManager::GetTick(float WorldTime) const
+{
+	return static_cast<uint64>(FMath::Max(WorldTime, 0.0f) / Resolution);
+}
+
+FTimerWheelHandle ATimerWheelManager::SetTimer(float Delay, const FSimpleDelegate& Delegate)
+{
+	// Round up, so timers never fire early.
+	const uint64 ExpiryTick = GetTick(GetWorld()->GetTimeSeconds() + FMath::Max(Delay, 0.0f)) + 1;
+	if (Wheel.Num() == 0)
+	{
+		Wheel.Advance(GetTick(GetWorld()->GetTimeSeconds()));
+	}
+
+	SetActorTickEnabled(true);
+	return Wheel.Add(ExpiryTick, Delegate);
+}
+
+void ATimerWheelManager::ClearTimer(FTimerWheelHandle& Handle)
+{
+	Wheel.Cancel(Handle);
+}
+
+void ATimerWheelManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_GDKTimerWheelAdvance);
+		Wheel.Advance(GetTick(GetWorld()->GetTimeSeconds()));
+	}
+	SET_DWORD_STAT(STAT_GDKTimerWheelPending, Wheel.Num());
+
+	if (Wheel.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void ATimerWheelManager::RunBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 NumTimers = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+
+	// A standalone wheel, so the benchmark doesn't disturb gameplay timers.
+	FGDKTimerWheel Wheel;
+	FRandomStream Random(NumTimers);
+	int32 NumFired = 0;
+	const FSimpleDelegate Delegate = FSimpleDelegate::CreateLambda([&NumFired]() { ++NumFired; });
+
+	// Lifetimes of up to ten seconds at 30 ticks per second.
+	const int32 MaxDelay = 300;
+	TArray<FTimerWheelHandle> Handles;
+	Handles.Reserve(NumTimers);
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumTimers; ++Index)
+	{
+		Handles.Add(Wheel.Add(Random.RandRange(1, MaxDelay), Delegate));
+	}
+	const double AddSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumTimers; Index += 2)
+	{
+		Wheel.Cancel(Handles[Index]);
+	}
+	const double CancelSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Tick = 1; Tick <= MaxDelay; ++Tick)
+	{
+		Wheel.Advance(Tick);
+	}
+	const double AdvanceSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogGDK, Display, TEXT("GDK.BenchmarkTimerWheel: %d timers, %d fired."), NumTimers, NumFired);
+	UE_LOG(LogGDK, Display, TEXT("  Add:     %8.1f ns per timer"), AddSeconds * 1.e9 / NumTimers);
+	UE_LOG(LogGDK, Display, TEXT("  Cancel:  %8.1f ns per timer"), CancelSeconds * 1.e9 / FMath::DivideAndRoundUp(NumTimers, 2));
+	UE_LOG(LogGDK, Display, TEXT("  Advance: %8.3f us per tick"), AdvanceSeconds * 1.e6 / MaxDelay);
+}
@@ -7,6 +7,7 @@
 #include "Game/Components/LobbyTimerComponent.h"
 #include "Game/Components/MatchTimerComponent.h"
 #include "Game/Components/PlayerCountingComponent.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "GameFramework/GameStateBase.h"
 #include "Weapons/InstantWeapon.h"
 
@@ -35,37 +36,37 @@ void UGDKWidget::NativeConstruct()
 		OnPawn(GDKPlayerController->GetPawn());
 	}
 
-	if (UControllerEventsComponent* ControllerEvents = Cast<UControllerEventsComponent>(PlayerController->GetComponentByClass(UControllerEventsComponent::StaticClass())))
+	if (UControllerEventsComponent* ControllerEvents = FComponentRegistry::Get<UControllerEventsComponent>(PlayerController))
 	{
 		ControllerEvents->KillDetailsEvent.AddDynamic(this, &UGDKWidget::OnKill);
 		ControllerEvents->DeathDetailsEvent.AddDynamic(this, &UGDKWidget::OnDeath);
 	}
 
-	if (UDeathmatchScoreComponent* Deathmatch = Cast<UDeathmatchScoreComponent>(GetWorld()->GetGameState()->GetComponentByClass(UDeathmatchScoreComponent::StaticClass())))
+	if (UDeathmatchScoreComponent* Deathmatch = FComponentRegistry::Get<UDeathmatchScoreComponent>(GetWorld()->GetGameState()))
 	{
 		Deathmatch->ScoreEvent.AddDynamic(this, &UGDKWidget::OnPlayerScoresUpdated);
 		OnPlayerScoresUpdated(Deathmatch->PlayerScores());
 	}
 
-	if (UPlayerCountingComponent* PlayerCounter = Cast<UPlayerCountingComponent>(GetWorld()->GetGameState()->GetComponentByClass(UPlayerCountingComponent::StaticClass())))
+	if (UPlayerCountingComponent* PlayerCounter = FComponentRegistry::Get<UPlayerCountingComponent>(GetWorld()->GetGameState()))
 	{
 		PlayerCounter->PlayerCountEvent.AddDynamic(this, &UGDKWidget::OnPlayerCountUpdated);
 		OnPlayerCountUpdated(PlayerCounter->PlayerCount());
 	}
 
-	if (UMatchStateComponent* MatchState = Cast<UMatchStateComponent>(GetWorld()->GetGameState()->GetComponentByClass(UMatchStateComponent::StaticClass())))
+	if (UMatchStateComponent* MatchState = FComponentRegistry::Get<UMatchStateComponent>(GetWorld()->GetGameState()))
 	{
 		MatchState->MatchEvent.AddDynamic(this, &UGDKWidget::OnStateUpdated);
 		OnStateUpdated(MatchState->GetCurrentState());
 	}
 
-	if (UMatchTimerComponent* MatchTimer = Cast<UMatchTimerComponent>(GetWorld()->GetGameState()->GetComponentByClass(UMatchTimerComponent::StaticClass())))
+	if (UMatchTimerComponent* MatchTimer = FComponentRegistry::Get<UMatchTimerComponent>(GetWorld()->GetGameState()))
 	{
 		MatchTimer->OnTimer.AddDynamic(this, &UGDKWidget::OnMatchTimerUpdated);
 		OnMatchTimerUpdated(MatchTimer->GetTimer());
 	}
 
-	if (ULobbyTimerComponent* LobbyTimer = Cast<ULobbyTimerComponent>(GetWorld()->GetGameState()->GetComponentByClass(ULobbyTimerComponent::StaticClass())))
+	if (ULobbyTimerComponent* LobbyTimer = FComponentRegistry::Get<ULobbyTimerComponent>(GetWorld()->GetGameState()))
 	{
 		LobbyTimer->OnTimer.AddDynamic(this, &UGDKWidget::OnLobbyTimerUpdated);
 		OnLobbyTimerUpdated(LobbyTimer->GetTimer());
@@ -79,12 +80,12 @@ void UGDKWidget::OnPawn(APawn* InPawn)
 		return;
 	}
 
-	if (UGDKMovementComponent* Movement = Cast< UGDKMovementComponent>(InPawn->GetComponentByClass(UGDKMovementComponent::StaticClass())))
+	if (UGDKMovementComponent* Movement = FComponentRegistry::Get<UGDKMovementComponent>(InPawn))
 	{
 		Movement->OnAimingUpdated.AddUniqueDynamic(this, &UGDKWidget::OnAimingUpdated);
 	}
 
-	if (UHealthComponent* Health = Cast< UHealthComponent>(InPawn->GetComponentByClass(UHealthComponent::StaticClass())))
+	if (UHealthComponent* Health = FComponentRegistry::Get<UHealthComponent>(InPawn))
 	{
 		Health->HealthUpdated.AddUniqueDynamic(this, &UGDKWidget::OnHealthUpdated);
 		Health->ArmourUpdated.AddUniqueDynamic(this, &UGDKWidget::OnArmourUpdated);
@@ -92,7 +93,7 @@ void UGDKWidget::OnPawn(APawn* InPawn)
 		OnArmourUpdated(Health->GetCurrentArmour(), Health->GetMaxArmour());
 	}
 
-	if (UShootingComponent* Shooting = Cast< UShootingComponent>(InPawn->GetComponentByClass(UShootingComponent::StaticClass())))
+	if (UShootingComponent* Shooting = FComponentRegistry::Get<UShootingComponent>(InPawn))
 	{
 		Shooting->ShotEvent.AddUniqueDynamic(this, &UGDKWidget::OnShot);
 	}
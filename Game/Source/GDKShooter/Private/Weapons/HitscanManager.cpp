@@ -0,0 +1,506 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "HitscanManager.h"
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/Character.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("HitscanRebuild"), STAT_GDKHitscanRebuild, STATGROUP_GDKShooter);
+DECLARE_CYCLE_STAT(TEXT("HitscanLineTrace"), STAT_GDKHitscanLineTrace, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkHitscanCommand(
+	TEXT("GDK.BenchmarkHitscan"),
+	TEXT("Compares traces per second against hitscan proxies with complex physics traces. Usage: GDK.BenchmarkHitscan [NumTraces]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&AHitscanManager::RunBenchmark));
+
+namespace
+{
+	// Location of the bounds used to pad unused lanes. Far enough that no shot can reach it.
+	const float PaddingLocation = 1.e30f;
+
+	struct FRay4
+	{
+		VectorRegister OX, OY, OZ;
+		VectorRegister DX, DY, DZ;
+		VectorRegister InvDX, InvDY, InvDZ;
+	};
+
+	struct FCapsuleShape
+	{
+		FVector A;
+		FVector B;
+		FVector Centre;
+		float Radius;
+		int32 ProxyIndex;
+	};
+
+	float SafeReciprocal(float Value)
+	{
+		if (FMath::Abs(Value) < SMALL_NUMBER)
+		{
+			return Value < 0.0f ? -1.0f / SMALL_NUMBER : 1.0f / SMALL_NUMBER;
+		}
+		return 1.0f / Value;
+	}
+
+	FRay4 MakeRay(const FVector& Origin, const FVector& Direction)
+	{
+		FRay4 Ray;
+		Ray.OX = VectorSetFloat1(Origin.X);
+		Ray.OY = VectorSetFloat1(Origin.Y);
+		Ray.OZ = VectorSetFloat1(Origin.Z);
+		Ray.DX = VectorSetFloat1(Direction.X);
+		Ray.DY = VectorSetFloat1(Direction.Y);
+		Ray.DZ = VectorSetFloat1(Direction.Z);
+		Ray.InvDX = VectorSetFloat1(SafeReciprocal(Direction.X));
+		Ray.InvDY = VectorSetFloat1(SafeReciprocal(Direction.Y));
+		Ray.InvDZ = VectorSetFloat1(SafeReciprocal(Direction.Z));
+		return Ray;
+	}
+
+	FORCEINLINE VectorRegister Dot3(const VectorRegister& AX, const VectorRegister& AY, const VectorRegister& AZ,
+		const VectorRegister& BX, const VectorRegister& BY, const VectorRegister& BZ)
+	{
+		return VectorMultiplyAdd(AX, BX, VectorMultiplyAdd(AY, BY, VectorMultiply(AZ, BZ)));
+	}
+
+	FORCEINLINE VectorRegister SafeSqrt(const VectorRegister& Value)
+	{
+		const VectorRegister Clamped = VectorMax(Value, VectorSetFloat1(SMALL_NUMBER));
+		return VectorMultiply(Clamped, VectorReciprocalSqrtAccurate(Clamped));
+	}
+
+	// Slab test of a ray against four bounds. Returns a bitmask of the lanes the ray enters between 0 and MaxDistance,
+	// and the entry distance of each lane in OutNear.
+	FORCEINLINE int32 IntersectBounds4(const FHitscanBounds4& Bounds, const FRay4& Ray, const VectorRegister& MaxDistance, VectorRegister& OutNear)
+	{
+		const VectorRegister T1X = VectorMultiply(VectorSubtract(Bounds.MinX, Ray.OX), Ray.InvDX);
+		const VectorRegister T2X = VectorMultiply(VectorSubtract(Bounds.MaxX, Ray.OX), Ray.InvDX);
+		const VectorRegister T1Y = VectorMultiply(VectorSubtract(Bounds.MinY, Ray.OY), Ray.InvDY);
+		const VectorRegister T2Y = VectorMultiply(VectorSubtract(Bounds.MaxY, Ray.OY), Ray.InvDY);
+		const VectorRegister T1Z = VectorMultiply(VectorSubtract(Bounds.MinZ, Ray.OZ), Ray.InvDZ);
+		const VectorRegister T2Z = VectorMultiply(VectorSubtract(Bounds.MaxZ, Ray.OZ), Ray.InvDZ);
+
+		const VectorRegister Near = VectorMax(VectorMin(T1X, T2X), VectorMax(VectorMin(T1Y, T2Y), VectorMin(T1Z, T2Z)));
+		const VectorRegister Far = VectorMin(VectorMax(T1X, T2X), VectorMin(VectorMax(T1Y, T2Y), VectorMax(T1Z, T2Z)));
+
+		OutNear = VectorMax(Near, VectorZero());
+		return VectorMaskBits(VectorCompareGE(VectorMin(Far, MaxDistance), OutNear));
+	}
+
+	// Ray against four capsules, as the union of the cylinder between the cap centres and the two cap spheres.
+	// The ray origin is moved up to each lane's bounds entry point first, to keep the quadratics well conditioned for long shots.
+	// Returns the distance to the first hit per lane, or BIG_NUMBER for lanes that are missed.
+	FORCEINLINE VectorRegister IntersectCapsules4(const FHitscanPacket& Packet, const FRay4& Ray, const VectorRegister& Near)
+	{
+		const VectorRegister Miss = VectorSetFloat1(BIG_NUMBER);
+		const VectorRegister Epsilon = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+		const VectorRegister OAX = VectorSubtract(VectorMultiplyAdd(Ray.DX, Near, Ray.OX), Packet.AX);
+		const VectorRegister OAY = VectorSubtract(VectorMultiplyAdd(Ray.DY, Near, Ray.OY), Packet.AY);
+		const VectorRegister OAZ = VectorSubtract(VectorMultiplyAdd(Ray.DZ, Near, Ray.OZ), Packet.AZ);
+
+		const VectorRegister BABA = Packet.BALengthSq;
+		const VectorRegister BARD = Dot3(Packet.BAX, Packet.BAY, Packet.BAZ, Ray.DX, Ray.DY, Ray.DZ);
+		const VectorRegister BAOA = Dot3(Packet.BAX, Packet.BAY, Packet.BAZ, OAX, OAY, OAZ);
+		const VectorRegister RDOA = Dot3(Ray.DX, Ray.DY, Ray.DZ, OAX, OAY, OAZ);
+		const VectorRegister OAOA = Dot3(OAX, OAY, OAZ, OAX, OAY, OAZ);
+
+		// Cylinder, only counting hits between the two cap centres.
+		const VectorRegister A = VectorSubtract(BABA, VectorMultiply(BARD, BARD));
+		const VectorRegister B = VectorSubtract(VectorMultiply(BABA, RDOA), VectorMultiply(BAOA, BARD));
+		const VectorRegister C = VectorSubtract(VectorSubtract(VectorMultiply(BABA, OAOA), VectorMultiply(BAOA, BAOA)), VectorMultiply(Packet.RadiusSq, BABA));
+		const VectorRegister H = VectorSubtract(VectorMultiply(B, B), VectorMultiply(A, C));
+		const VectorRegister TCylinder = VectorMultiply(VectorSubtract(VectorNegate(B), SafeSqrt(H)), VectorReciprocalAccurate(VectorMax(A, Epsilon)));
+		const VectorRegister Y = VectorMultiplyAdd(TCylinder, BARD, BAOA);
+		const VectorRegister CylinderMask = VectorBitwiseAnd(
+			VectorBitwiseAnd(VectorCompareGE(H, VectorZero()), VectorCompareGT(A, Epsilon)),
+			VectorBitwiseAnd(VectorCompareGT(Y, VectorZero()), VectorCompareGT(BABA, Y)));
+		VectorRegister T = VectorSelect(CylinderMask, TCylinder, Miss);
+
+		// Sphere around A.
+		const VectorRegister HA = VectorSubtract(VectorMultiply(RDOA, RDOA), VectorSubtract(OAOA, Packet.RadiusSq));
+		const VectorRegister TA = VectorSubtract(VectorNegate(RDOA), SafeSqrt(HA));
+		T = VectorMin(T, VectorSelect(VectorCompareGE(HA, VectorZero()), TA, Miss));
+
+		// Sphere around B, where the origin relative to B is OA - BA.
+		const VectorRegister BB = VectorSubtract(RDOA, BARD);
+		const VectorRegister CB = VectorSubtract(VectorAdd(VectorSubtract(OAOA, VectorAdd(BAOA, BAOA)), BABA), Packet.RadiusSq);
+		const VectorRegister HB = VectorSubtract(VectorMultiply(BB, BB), CB);
+		const VectorRegister TB = VectorSubtract(VectorNegate(BB), SafeSqrt(HB));
+		T = VectorMin(T, VectorSelect(VectorCompareGE(HB, VectorZero()), TB, Miss));
+
+		return VectorAdd(T, Near);
+	}
+
+	VectorRegister LoadLanes(const float (&Lanes)[4])
+	{
+		return MakeVectorRegister(Lanes[0], Lanes[1], Lanes[2], Lanes[3]);
+	}
+
+	void SetBoundsLanes(FHitscanBounds4& Bounds, const FBox (&Boxes)[4])
+	{
+		float MinX[4], MinY[4], MinZ[4], MaxX[4], MaxY[4], MaxZ[4];
+		for (int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			MinX[Lane] = Boxes[Lane].Min.X;
+			MinY[Lane] = Boxes[Lane].Min.Y;
+			MinZ[Lane] = Boxes[Lane].Min.Z;
+			MaxX[Lane] = Boxes[Lane].Max.X;
+			MaxY[Lane] = Boxes[Lane].Max.Y;
+			MaxZ[Lane] = Boxes[Lane].Max.Z;
+		}
+		Bounds.MinX = LoadLanes(MinX);
+		Bounds.MinY = LoadLanes(MinY);
+		Bounds.MinZ = LoadLanes(MinZ);
+		Bounds.MaxX = LoadLanes(MaxX);
+		Bounds.MaxY = LoadLanes(MaxY);
+		Bounds.MaxZ = LoadLanes(MaxZ);
+	}
+}
+
+AHitscanManager::AHitscanManager()
+	: BuiltFrame(0)
+{
+}
+
+void AHitscanManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<ACharacter> It(GetWorld()); It; ++It)
+	{
+		RegisterProxy(It->GetCapsuleComponent());
+	}
+}
+
+void AHitscanManager::RegisterProxy(UCapsuleComponent* Capsule)
+{
+	if (Capsule != nullptr)
+	{
+		Proxies.AddUnique(Capsule);
+		BuiltFrame = 0;
+	}
+}
+
+void AHitscanManager::UnregisterProxy(UCapsuleComponent* Capsule)
+{
+	Proxies.RemoveSwap(Capsule);
+	BuiltFrame = 0;
+}
+
+void AHitscanManager::RebuildIfNeeded()
+{
+	if (BuiltFrame == GFrameCounter)
+	{
+		return;
+	}
+	BuiltFrame = GFrameCounter;
+
+	SCOPE_CYCLE_COUNTER(STAT_GDKHitscanRebuild);
+
+	TArray<FCapsuleShape> Shapes;
+	Shapes.Reserve(Proxies.Num());
+	ProxyActorIds.SetNumZeroed(Proxies.Num());
+	FBox CentreBounds(ForceInit);
+
+	for (int32 ProxyIndex = 0; ProxyIndex < Proxies.Num(); ++ProxyIndex)
+	{
+		UCapsuleComponent* Capsule = Proxies[ProxyIndex].Get();
+		// Capsules stop colliding when their character dies and ragdolls.
+		if (Capsule == nullptr || Capsule->GetOwner() == nullptr || !Capsule->IsCollisionEnabled())
+		{
+			continue;
+		}
+
+		ProxyActorIds[ProxyIndex] = Capsule->GetOwner()->GetUniqueID();
+
+		FCapsuleShape& Shape = Shapes.AddDefaulted_GetRef();
+		const FVector Axis = Capsule->GetUpVector() * Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+		Shape.Centre = Capsule->GetComponentLocation();
+		Shape.A = Shape.Centre - Axis;
+		Shape.B = Shape.Centre + Axis;
+		Shape.Radius = Capsule->GetScaledCapsuleRadius();
+		Shape.ProxyIndex = ProxyIndex;
+		CentreBounds += Shape.Centre;
+	}
+
+	// Sort along the widest axis so that packets and nodes stay spatially tight.
+	const FVector CentreExtent = CentreBounds.IsValid ? CentreBounds.GetSize() : FVector::ZeroVector;
+	const int32 SortAxis = CentreExtent.X >= CentreExtent.Y && CentreExtent.X >= CentreExtent.Z ? 0 : (CentreExtent.Y >= CentreExtent.Z ? 1 : 2);
+	Shapes.Sort([SortAxis](const FCapsuleShape& Lhs, const FCapsuleShape& Rhs)
+	{
+		return Lhs.Centre[SortAxis] < Rhs.Centre[SortAxis];
+	});
+
+	const FBox PaddingBox(FVector(PaddingLocation), FVector(PaddingLocation));
+	const int32 NumPackets = FMath::DivideAndRoundUp(Shapes.Num(), 4);
+	const int32 NumNodes = FMath::DivideAndRoundUp(NumPackets, 4);
+	Packets.SetNumUninitialized(NumPackets);
+	PacketLaneProxies.SetNumUninitialized(NumPackets * 4);
+	Nodes.SetNumUninitialized(NumNodes);
+
+	FBox NodePacketBoxes[4] = { PaddingBox, PaddingBox, PaddingBox, PaddingBox };
+	for (int32 PacketIndex = 0; PacketIndex < NumPackets; ++PacketIndex)
+	{
+		FBox LaneBoxes[4];
+		float AX[4], AY[4], AZ[4], BAX[4], BAY[4], BAZ[4], BALengthSq[4], RadiusSq[4];
+		FBox PacketBox(ForceInit);
+
+		for (int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const int32 ShapeIndex = PacketIndex * 4 + Lane;
+			if (ShapeIndex >= Shapes.Num())
+			{
+				LaneBoxes[Lane] = PaddingBox;
+				AX[Lane] = AY[Lane] = AZ[Lane] = BAX[Lane] = BAY[Lane] = BAZ[Lane] = BALengthSq[Lane] = RadiusSq[Lane] = 0.0f;
+				PacketLaneProxies[ShapeIndex] = INDEX_NONE;
+				continue;
+			}
+
+			const FCapsuleShape& Shape = Shapes[ShapeIndex];
+			const FVector BA = Shape.B - Shape.A;
+			LaneBoxes[Lane] = FBox(Shape.A.ComponentMin(Shape.B) - FVector(Shape.Radius), Shape.A.ComponentMax(Shape.B) + FVector(Shape.Radius));
+			AX[Lane] = Shape.A.X;
+			AY[Lane] = Shape.A.Y;
+			AZ[Lane] = Shape.A.Z;
+			BAX[Lane] = BA.X;
+			BAY[Lane] = BA.Y;
+			BAZ[Lane] = BA.Z;
+			BALengthSq[Lane] = BA.SizeSquared();
+			RadiusSq[Lane] = Shape.Radius * Shape.Radius;
+			PacketLaneProxies[ShapeIndex] = Shape.ProxyIndex;
+			PacketBox += LaneBoxes[Lane];
+		}
+
+		FHitscanPacket& Packet = Packets[PacketIndex];
+		SetBoundsLanes(Packet.Bounds, LaneBoxes);
+		Packet.AX = LoadLanes(AX);
+		Packet.AY = LoadLanes(AY);
+		Packet.AZ = LoadLanes(AZ);
+		Packet.BAX = LoadLanes(BAX);
+		Packet.BAY = LoadLanes(BAY);
+		Packet.BAZ = LoadLanes(BAZ);
+		Packet.BALengthSq = LoadLanes(BALengthSq);
+		Packet.RadiusSq = LoadLanes(RadiusSq);
+
+		NodePacketBoxes[PacketIndex % 4] = PacketBox;
+		if (PacketIndex % 4 == 3 || PacketIndex == NumPackets - 1)
+		{
+			SetBoundsLanes(Nodes[PacketIndex / 4], NodePacketBoxes);
+			NodePacketBoxes[0] = NodePacketBoxes[1] = NodePacketBoxes[2] = NodePacketBoxes[3] = PaddingBox;
+		}
+	}
+}
+
+int32 AHitscanManager::TraceProxies(const FVector& Start, const FVector& Direction, float MaxDistance, const FCollisionQueryParams& Params, float& OutDistance) const
+{
+	const FRay4 Ray = MakeRay(Start, Direction);
+	const auto& IgnoredActors = Params.GetIgnoredActors();
+
+	float BestDistance = MaxDistance;
+	int32 BestProxy = INDEX_NONE;
+	MS_ALIGN(16) float LaneDistances[4] GCC_ALIGN(16);
+
+	for (int32 NodeIndex = 0; NodeIndex < Nodes.Num(); ++NodeIndex)
+	{
+		VectorRegister NodeNear;
+		int32 NodeMask = IntersectBounds4(Nodes[NodeIndex], Ray, VectorSetFloat1(BestDistance), NodeNear);
+
+		while (NodeMask != 0)
+		{
+			const int32 PacketIndex = NodeIndex * 4 + FMath::CountTrailingZeros(NodeMask);
+			NodeMask &= NodeMask - 1;
+			if (PacketIndex >= Packets.Num())
+			{
+				continue;
+			}
+
+			const FHitscanPacket& Packet = Packets[PacketIndex];
+			VectorRegister PacketNear;
+			int32 PacketMask = IntersectBounds4(Packet.Bounds, Ray, VectorSetFloat1(BestDistance), PacketNear);
+			if (PacketMask == 0)
+			{
+				continue;
+			}
+
+			VectorStoreAligned(IntersectCapsules4(Packet, Ray, PacketNear), LaneDistances);
+
+			while (PacketMask != 0)
+			{
+				const int32 Lane = FMath::CountTrailingZeros(PacketMask);
+				PacketMask &= PacketMask - 1;
+
+				const int32 ProxyIndex = PacketLaneProxies[PacketIndex * 4 + Lane];
+				const float Distance = LaneDistances[Lane];
+				if (ProxyIndex != INDEX_NONE && Distance >= 0.0f && Distance < BestDistance && !IgnoredActors.Contains(ProxyActorIds[ProxyIndex]))
+				{
+					BestDistance = Distance;
+					BestProxy = ProxyIndex;
+				}
+			}
+		}
+	}
+
+	OutDistance = BestDistance;
+	return BestProxy;
+}
+
+bool AHitscanManager::TraceOccluders(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params) const
+{
+	// Characters are traced as proxies, so the physics scene only needs to find what blocks them.
+	FCollisionQueryParams OccluderParams = Params;
+	for (uint32 ActorId : ProxyActorIds)
+	{
+		if (ActorId != 0)
+		{
+			OccluderParams.AddIgnoredActor(ActorId);
+		}
+	}
+	return GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, TraceChannel, OccluderParams);
+}
+
+void AHitscanManager::MakeProxyHit(FHitResult& OutHit, int32 ProxyIndex, const FVector& Start, const FVector& End, float Distance, const FCollisionQueryParams& Params) const
+{
+	UCapsuleComponent* Capsule = Proxies[ProxyIndex].Get();
+	const FVector HitLocation = Start + (End - Start).GetSafeNormal() * Distance;
+	const FVector Axis = Capsule->GetUpVector() * Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+	const FVector ClosestOnAxis = FMath::ClosestPointOnSegment(HitLocation, Capsule->GetComponentLocation() - Axis, Capsule->GetComponentLocation() + Axis);
+
+	OutHit = FHitResult(Capsule->GetOwner(), Capsule, HitLocation, (HitLocation - ClosestOnAxis).GetSafeNormal());
+	OutHit.bBlockingHit = true;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	OutHit.Distance = Distance;
+	OutHit.Time = Distance / (End - Start).Size();
+
+	// A physics trace would have hit a body of the character's mesh, so report the bone nearest the hit.
+	const FBodyInstance* Body = Capsule->GetBodyInstance();
+	ACharacter* Character = Cast<ACharacter>(Capsule->GetOwner());
+	USkeletalMeshComponent* Mesh = Character != nullptr ? Character->GetMesh() : nullptr;
+	if (Mesh != nullptr && Mesh->GetPhysicsAsset() != nullptr)
+	{
+		const FName BoneName = Mesh->FindClosestBone(HitLocation, nullptr, 0.0f, true);
+		if (const FBodyInstance* BoneBody = BoneName != NAME_None ? Mesh->GetBodyInstance(BoneName) : nullptr)
+		{
+			OutHit.Component = Mesh;
+			OutHit.BoneName = BoneName;
+			Body = BoneBody;
+		}
+	}
+
+	if (Params.bReturnPhysicalMaterial && Body != nullptr)
+	{
+		OutHit.PhysMaterial = Body->GetSimplePhysicalMaterial();
+	}
+}
+
+bool AHitscanManager::LineTrace(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKHitscanLineTrace);
+
+	const FVector Delta = End - Start;
+	const float Length = Delta.Size();
+	if (Length < KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+	const FVector Direction = Delta / Length;
+
+	RebuildIfNeeded();
+
+	// Trace the occluders first, so that proxies behind them are culled by the shortened ray.
+	FHitResult OccluderHit(ForceInit);
+	const bool bHitOccluder = TraceOccluders(OccluderHit, Start, End, TraceChannel, Params);
+
+	float ProxyDistance = 0.0f;
+	const int32 ProxyIndex = TraceProxies(Start, Direction, bHitOccluder ? OccluderHit.Distance : Length, Params, ProxyDistance);
+	if (ProxyIndex == INDEX_NONE || !Proxies[ProxyIndex].IsValid())
+	{
+		OutHit = OccluderHit;
+		return bHitOccluder;
+	}
+
+	MakeProxyHit(OutHit, ProxyIndex, Start, End, ProxyDistance, Params);
+	return true;
+}
+
+void AHitscanManager::RunBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	AHitscanManager* Manager = AGDKWorldManager::Find<AHitscanManager>(World);
+	if (Manager == nullptr || Manager->Proxies.Num() == 0)
+	{
+		UE_LOG(LogGDK, Warning, TEXT("GDK.BenchmarkHitscan: no hitscan proxies are registered in this world."));
+		return;
+	}
+
+	const int32 NumTraces = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+
+	// Shots from a few metres away, aimed near random characters.
+	FRandomStream Random(NumTraces);
+	TArray<FVector> Starts;
+	TArray<FVector> Ends;
+	Starts.Reserve(NumTraces);
+	Ends.Reserve(NumTraces);
+	for (int32 Index = 0; Index < NumTraces; ++Index)
+	{
+		UCapsuleComponent* Target = Manager->Proxies[Random.RandHelper(Manager->Proxies.Num())].Get();
+		if (Target == nullptr)
+		{
+			continue;
+		}
+
+		const FVector AimPoint = Target->GetComponentLocation() + Random.GetUnitVector() * Target->GetScaledCapsuleRadius() * 2.0f;
+		const FVector Start = AimPoint + Random.GetUnitVector() * 3000.0f;
+		Starts.Add(Start);
+		Ends.Add(Start + (AimPoint - Start).GetSafeNormal() * 50000.0f);
+	}
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(GDKHitscanBenchmark), true);
+	Params.bReturnPhysicalMaterial = false;
+
+	double StartTime = FPlatformTime::Seconds();
+	int32 PhysicsHits = 0;
+	for (int32 Index = 0; Index < Starts.Num(); ++Index)
+	{
+		FHitResult Hit;
+		PhysicsHits += World->LineTraceSingleByChannel(Hit, Starts[Index], Ends[Index], ECC_WorldStatic, Params) ? 1 : 0;
+	}
+	const double PhysicsSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	Manager->BuiltFrame = 0;
+	Manager->RebuildIfNeeded();
+	const double RebuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	int32 ProxyHits = 0;
+	for (int32 Index = 0; Index < Starts.Num(); ++Index)
+	{
+		FHitResult Hit;
+		ProxyHits += Manager->LineTrace(Hit, Starts[Index], Ends[Index], ECC_WorldStatic, Params) ? 1 : 0;
+	}
+	const double ProxySeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	int32 ProxyOnlyHits = 0;
+	for (int32 Index = 0; Index < Starts.Num(); ++Index)
+	{
+		const FVector Delta = Ends[Index] - Starts[Index];
+		float Distance;
+		ProxyOnlyHits += Manager->TraceProxies(Starts[Index], Delta.GetSafeNormal(), Delta.Size(), Params, Distance) != INDEX_NONE ? 1 : 0;
+	}
+	const double ProxyOnlySeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogGDK, Display, TEXT("GDK.BenchmarkHitscan: %d traces, %d proxies, rebuild %.3f ms."), Starts.Num(), Manager->Proxies.Num(), RebuildSeconds * 1000.0);
+	UE_LOG(LogGDK, Display, TEXT("  Complex physics trace:        %10.0f traces/s (%d hits)"), Starts.Num() / FMath::Max(PhysicsSeconds, SMALL_NUMBER), PhysicsHits);
+	UE_LOG(LogGDK, Display, TEXT("  Proxies with occluders:       %10.0f traces/s (%d hits)"), Starts.Num() / FMath::Max(ProxySeconds, SMALL_NUMBER), ProxyHits);
+	UE_LOG(LogGDK, Display, TEXT("  Proxies only:                 %10.0f traces/s (%d hits)"), Starts.Num() / FMath::Max(ProxyOnlySeconds, SMALL_NUMBER), ProxyOnlyHits);
+}
@@ -3,14 +3,25 @@
 #include "InstantWeapon.h"
 
 #include "Engine/World.h"
+#include "GameFramework/ComponentRegistry.h"
 #include "Kismet/GameplayStatics.h"
 #include "GameFramework/DamageType.h"
+#include "GameFramework/PlayerState.h"
+#include "Characters/Components/HitboxHistoryComponent.h"
 #include "GDKLogging.h"
+#include "GDKStats.h"
 #include "UnrealNetwork.h"
 
+DECLARE_CYCLE_STAT(TEXT("ValidateHit"), STAT_GDKValidateHit, STATGROUP_GDKShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("DroppedShots"), STAT_GDKDroppedShots, STATGROUP_GDKShooter);
 
 AInstantWeapon::AInstantWeapon()
 {
+	// Ticks only to send the shots fired during a frame, after they have all been fired.
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
 	BurstInterval = 0.5f;
 	BurstCount = 1;
 	ShotInterval = 0.2f;
@@ -20,6 +31,84 @@ AInstantWeapon::AInstantWeapon()
 	HitValidationTolerance = 50.0f;
 	DamageTypeClass = UDamageType::StaticClass();  // generic damage type
 	ShotVisualizationDelayTolerance = FTimespan::FromMilliseconds(3000.0f);
+	ShotVisualizationCapacity = 16;
+	bBatchShotReports = true;
+	MaxShotsPerReport = 16;
+	bPendingShotsHaveHit = false;
+	PelletsPerShot = 1;
+	bUseAsyncTraces = false;
+	SpreadSeed = 0;
+	NextShotIndex = 0;
+	LastValidatedShotIndex = INDEX_NONE;
+	DroppedShotCount = 0;
+}
+
+void AInstantWeapon::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Bound per instance, so it is never copied from a Blueprint's default object or saved.
+	RecentShots.Weapon = this;
+}
+
+void AInstantWeapon::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (HasAuthority())
+	{
+		SpreadSeed = FMath::Rand();
+		ConfigureShotTokenBucket();
+	}
+}
+
+void AInstantWeapon::ConfigureShotTokenBucket()
+{
+	// Sustained rate: a full burst per burst period, or one shot per interval for full-auto.
+	const int32 ShotsPerBurst = FMath::Max(BurstCount, 1);
+	const float BurstPeriod = IsFullyAutomatic() ? ShotInterval : FMath::Max(BurstInterval, ShotsPerBurst * ShotInterval);
+	const float ShotsPerSecond = PelletsPerShot * ShotsPerBurst / FMath::Max(BurstPeriod, KINDA_SMALL_NUMBER);
+
+	const float Capacity = PelletsPerShot * ShotsPerBurst + ShotsPerSecond * FireRateTolerance;
+	ShotTokenBucket.Configure(FMath::Max(Capacity, static_cast<float>(MaxShotsPerReport)), ShotsPerSecond, GetWorld()->GetTimeSeconds());
+}
+
+void AInstantWeapon::SetOwner(AActor* NewOwner)
+{
+	// A new owner starts its own spread sequence.
+	if (HasAuthority() && NewOwner != GetOwner())
+	{
+		SpreadSeed = FMath::Rand();
+		LastValidatedShotIndex = INDEX_NONE;
+		AwaitingHits.Reset();
+		if (HasActorBegunPlay())
+		{
+			ConfigureShotTokenBucket();
+		}
+	}
+
+	Super::SetOwner(NewOwner);
+}
+
+void AInstantWeapon::OnRep_SpreadSeed()
+{
+	NextShotIndex = 0;
+}
+
+void AInstantWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AInstantWeapon, SpreadSeed, COND_OwnerOnly);
+	// The owner has already played its own shots locally.
+	DOREPLIFETIME_CONDITION(AInstantWeapon, RecentShots, COND_SkipOwner);
+}
+
+void AInstantWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FlushShotReports();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AInstantWeapon::StartPrimaryUse_Implementation()
@@ -42,6 +131,7 @@ void AInstantWeapon::StopPrimaryUse_Implementation()
 	if (!IsBurstFire() || bAllowContinuousBurstFire)
 	{
 		Super::StopPrimaryUse_Implementation();
+		FlushShotReports();
 	}
 }
 
@@ -56,18 +146,37 @@ void AInstantWeapon::DoFire_Implementation()
 
 	NextShotTime = UGameplayStatics::GetRealTimeSeconds(GetWorld()) + ShotInterval;
 	
-	FInstantHitInfo HitInfo = DoLineTrace();
-	if (HitInfo.bDidHit)
+	const int32 FirstShotIndex = NextShotIndex;
+	if (PelletsPerShot == 1 && !bUseAsyncTraces)
 	{
-		ServerDidHit(HitInfo);
-		SpawnFX(HitInfo, true);  // Spawn the hit fx locally
-		AnnounceShot(HitInfo.HitActor ? HitInfo.HitActor->bCanBeDamaged : false);
+		TArray<FInstantHitInfo> Results;
+		Results.Add(DoLineTrace());
+		HandleShotResults(Results, Results[0].FireTime, FirstShotIndex);
 	}
-	else
+	else if (UShootingComponent* ShootingComponent = GetShootingComponent())
 	{
-		ServerDidMiss(HitInfo);
-		SpawnFX(HitInfo, false);  // Spawn the hit fx locally
-		AnnounceShot(false);
+		TArray<FVector> Directions;
+		Directions.Reserve(PelletsPerShot);
+		for (int32 Pellet = 0; Pellet < PelletsPerShot; ++Pellet)
+		{
+			Directions.Add(GetLineTraceDirection());
+		}
+
+		const FLineTraceBatchComplete OnComplete = FLineTraceBatchComplete::CreateUObject(this, &AInstantWeapon::HandleShotResults, GetServerWorldTimeSeconds(), FirstShotIndex);
+		if (bUseAsyncTraces)
+		{
+			ShootingComponent->AsyncLineTraceBatch(Directions, this, OnComplete);
+		}
+		else
+		{
+			TArray<FInstantHitInfo> Results;
+			Results.Reserve(Directions.Num());
+			for (const FVector& Direction : Directions)
+			{
+				Results.Add(ShootingComponent->DoLineTrace(Direction, this));
+			}
+			OnComplete.Execute(Results);
+		}
 	}
 
 	if (IsBurstFire())
@@ -75,6 +184,7 @@ void AInstantWeapon::DoFire_Implementation()
 		--BurstShotsRemaining;
 		if (BurstShotsRemaining <= 0)
 		{
+			FlushShotReports();
 			FinishedBurst();
 			if (bAllowContinuousBurstFire)
 			{
@@ -99,33 +209,127 @@ FVector AInstantWeapon::GetLineTraceDirection()
 {
 	FVector Direction = Super::GetLineTraceDirection();
 
-	float SpreadToUse = SpreadAt100m;
-	if (GetMovementComponent())
-	{
-		if (GetMovementComponent()->IsAiming())
-		{
-			SpreadToUse = SpreadAt100mWhenAiming;
-		}
-		if (GetMovementComponent()->IsCrouching())
-		{
-			SpreadToUse *= SpreadCrouchModifier;
-		}
-	}
+	// Every direction consumes an index, so that pellets and shots line up with the indices reported to the server.
+	const int32 ShotIndex = NextShotIndex++;
 
+	float SpreadToUse = GetSpreadAt100m();
 	if (SpreadToUse > 0)
 	{
-		auto Spread = FMath::RandPointInCircle(SpreadToUse);
+		auto Spread = GetSpreadOffset(ShotIndex, SpreadToUse);
 		Direction = Direction.Rotation().RotateVector(FVector(10000, Spread.X, Spread.Y));
 	}
 
 	return Direction;
 }
 
-void AInstantWeapon::NotifyClientsOfHit(const FInstantHitInfo& HitInfo, bool bImpact)
+float AInstantWeapon::GetSpreadAt100m()
+{
+	if (GetMovementComponent())
+	{
+		return GetSpreadAt100m(GetMovementComponent()->IsAiming(), GetMovementComponent()->IsCrouching());
+	}
+	return SpreadAt100m;
+}
+
+float AInstantWeapon::GetSpreadAt100m(bool bAiming, bool bCrouching) const
+{
+	float SpreadToUse = bAiming ? SpreadAt100mWhenAiming : SpreadAt100m;
+	if (bCrouching)
+	{
+		SpreadToUse *= SpreadCrouchModifier;
+	}
+	return SpreadToUse;
+}
+
+FVector2D AInstantWeapon::GetSpreadOffset(int32 ShotIndex, float Spread) const
+{
+	FRandomStream Stream(HashCombine(GetTypeHash(SpreadSeed), GetTypeHash(ShotIndex)));
+
+	// Uniform over the disc, as FMath::RandPointInCircle, but without rejection sampling.
+	const float Radius = Spread * FMath::Sqrt(Stream.GetFraction());
+	const float Angle = 2.0f * PI * Stream.GetFraction();
+	return FVector2D(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle));
+}
+
+void AInstantWeapon::HandleShotResults(const TArray<FInstantHitInfo>& Results, float FireTime, int32 FirstShotIndex)
+{
+	bool bHitDamageable = false;
+	for (int32 Index = 0; Index < Results.Num(); ++Index)
+	{
+		FInstantHitInfo HitInfo = Results[Index];
+		HitInfo.FireTime = FireTime;
+		HitInfo.ShotIndex = FirstShotIndex + Index;
+		QueueShotReport(HitInfo);
+		SpawnFX(HitInfo, HitInfo.bDidHit);  // Spawn the hit fx locally
+		bHitDamageable |= HitInfo.bDidHit && HitInfo.HitActor != nullptr && HitInfo.HitActor->bCanBeDamaged;
+	}
+
+	AnnounceShot(bHitDamageable);
+
+	// Async results can arrive after the trigger was released or the burst ended, when the report was already flushed.
+	if (!IsPrimaryUsing)
+	{
+		FlushShotReports();
+	}
+}
+
+void AInstantWeapon::QueueShotReport(const FInstantHitInfo& HitInfo)
+{
+	PendingShots.Add(HitInfo);
+	bPendingShotsHaveHit |= HitInfo.bDidHit;
+
+	if (!bBatchShotReports || PendingShots.Num() >= MaxShotsPerReport)
+	{
+		FlushShotReports();
+	}
+	else
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+void AInstantWeapon::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	FlushShotReports();
+}
+
+void AInstantWeapon::FlushShotReports()
+{
+	if (!bTicksInBlueprint)
+	{
+		SetActorTickEnabled(false);
+	}
+
+	if (PendingShots.Num() == 0)
+	{
+		return;
+	}
+
+	// Hits must arrive, misses are only cosmetic.
+	if (bPendingShotsHaveHit)
+	{
+		ServerReportShots(PendingShots);
+	}
+	else
+	{
+		ServerReportMisses(PendingShots);
+	}
+
+	PendingShots.Reset();
+	bPendingShotsHaveHit = false;
+}
+
+void AInstantWeapon::NotifyClientsOfShots(const TArray<FInstantHitInfo>& Shots)
 {
 	check(GetNetMode() < NM_Client);
 
-	MulticastNotifyHit(HitInfo, bImpact);
+	const float ServerTime = GetWorld()->GetTimeSeconds();
+	for (const FInstantHitInfo& HitInfo : Shots)
+	{
+		RecentShots.AddShot(HitInfo, ServerTime, ShotVisualizationCapacity);
+	}
 }
 
 void AInstantWeapon::SpawnFX(const FInstantHitInfo& HitInfo, bool bImpact)
@@ -138,17 +342,31 @@ void AInstantWeapon::SpawnFX(const FInstantHitInfo& HitInfo, bool bImpact)
 	AInstantWeapon::OnRenderShot(HitInfo.Location, bImpact);
 }
 
-bool AInstantWeapon::ValidateHit(const FInstantHitInfo& HitInfo)
+bool AInstantWeapon::ValidateHit(const FInstantHitInfo& HitInfo, bool& bOutAwaitingView)
 {
 	check(GetNetMode() < NM_Client);
 
+	bOutAwaitingView = false;
 	if (HitInfo.HitActor == nullptr)
 	{
 		return false;
 	}
 
-	// Get the bounding box of the actor we hit.
-	const FBox HitBox = HitInfo.HitActor->GetComponentsBoundingBox();
+	SCOPE_CYCLE_COUNTER(STAT_GDKValidateHit);
+
+	// Replayed or reordered hits are rejected.
+	if (HitInfo.ShotIndex <= LastValidatedShotIndex || !ValidateShotDirection(HitInfo, bOutAwaitingView))
+	{
+		return false;
+	}
+
+	// Get the bounding box of the actor we hit, as it was when the shot was fired if we have its history.
+	FBox HitBox;
+	UHitboxHistoryComponent* HitboxHistory = FComponentRegistry::Get<UHitboxHistoryComponent>(HitInfo.HitActor);
+	if (HitboxHistory == nullptr || !HitboxHistory->GetHitboxAtTime(ClampFireTime(HitInfo.FireTime, HitboxHistory), HitBox))
+	{
+		HitBox = HitInfo.HitActor->GetComponentsBoundingBox();
+	}
 
 	// Calculate the extent of the box along all 3 axes an add a tolerance factor.
 	FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min) + (HitValidationTolerance * FVector::OneVector);
@@ -167,9 +385,95 @@ bool AInstantWeapon::ValidateHit(const FInstantHitInfo& HitInfo)
 		return false;
 	}
 
+	LastValidatedShotIndex = HitInfo.ShotIndex;
 	return true;
 }
 
+float AInstantWeapon::ClampFireTime(float FireTime, const UHitboxHistoryComponent* History) const
+{
+	// The client stamps shots with its estimate of server time, which lags a one-way trip behind, and the shot takes
+	// another one-way trip to arrive, so an honest shot reaches the server a full round trip after its fire time.
+	float RoundTrip = 0.0f;
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Pawn != nullptr && Pawn->PlayerState != nullptr)
+	{
+		// ExactPing is the round trip in milliseconds.
+		RoundTrip = Pawn->PlayerState->ExactPing * 0.001f;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float MaxRewind = FMath::Min(RoundTrip + FireTimeTolerance, History->GetMaxRewindTime());
+	return FMath::Clamp(FireTime, Now - MaxRewind, Now);
+}
+
+bool AInstantWeapon::ValidateShotDirection(const FInstantHitInfo& HitInfo, bool& bOutAwaitingView)
+{
+	// Shots fired by the server itself, by bots and turrets, are traced along the server's own aim.
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Pawn == nullptr || !Pawn->IsPlayerControlled() || Pawn->IsLocallyControlled())
+	{
+		return true;
+	}
+
+	UHitboxHistoryComponent* ViewHistory = FComponentRegistry::Get<UHitboxHistoryComponent>(Pawn);
+	if (ViewHistory == nullptr || !ViewHistory->GetViewsSince(ClampFireTime(HitInfo.FireTime, ViewHistory), ViewBuffer))
+	{
+		return false;
+	}
+
+	// The client fires along its own view, which reaches the server with its next move, so the shot's aim lies somewhere in
+	// the views the server recorded from the time of the shot until now. Between two views the aim may have swept, e.g. a flick.
+	for (int32 Index = 0; Index < ViewBuffer.Num(); ++Index)
+	{
+		const FViewSnapshot& From = ViewBuffer[Index];
+		const FViewSnapshot& To = ViewBuffer[FMath::Min(Index + 1, ViewBuffer.Num() - 1)];
+
+		const FVector ToHit = HitInfo.Location - From.ViewLocation;
+		const float Distance = ToHit.Size();
+		if (Distance < KINDA_SMALL_NUMBER)
+		{
+			return true;
+		}
+
+		// The spread direction is exact, given the stance.
+		FVector SpreadDirection = FVector::ForwardVector;
+		const float SpreadToUse = GetSpreadAt100m(From.bAiming, From.bCrouching);
+		if (SpreadToUse > 0)
+		{
+			const FVector2D Spread = GetSpreadOffset(HitInfo.ShotIndex, SpreadToUse);
+			SpreadDirection = FVector(10000, Spread.X, Spread.Y).GetSafeNormal();
+		}
+
+		// Solve for the aim, without roll, that fires the spread direction at the hit. Converges in a few steps for any sane spread.
+		const FRotator HitRotation = ToHit.Rotation();
+		FRotator Aim = HitRotation;
+		for (int32 Step = 0; Step < 4; ++Step)
+		{
+			Aim += (HitRotation - Aim.RotateVector(SpreadDirection).Rotation()).GetNormalized();
+		}
+
+		// The aim must lie on the shorter arc the view swept from one snapshot to the next, within the tolerance.
+		// Yaw matters less the steeper the aim.
+		const float Tolerance = MaxAimDeviation + FMath::RadiansToDegrees(FMath::Atan(MaxViewLocationDeviation / Distance));
+		const float YawTolerance = Tolerance / FMath::Max(FMath::Cos(FMath::DegreesToRadians(Aim.Pitch)), 0.1f);
+
+		const float PitchSweep = FRotator::NormalizeAxis(To.AimRotation.Pitch - From.AimRotation.Pitch);
+		const float PitchOffset = FRotator::NormalizeAxis(Aim.Pitch - From.AimRotation.Pitch);
+		const float YawSweep = FRotator::NormalizeAxis(To.AimRotation.Yaw - From.AimRotation.Yaw);
+		const float YawOffset = FRotator::NormalizeAxis(Aim.Yaw - From.AimRotation.Yaw);
+
+		if (PitchOffset >= FMath::Min(PitchSweep, 0.0f) - Tolerance && PitchOffset <= FMath::Max(PitchSweep, 0.0f) + Tolerance &&
+			YawOffset >= FMath::Min(YawSweep, 0.0f) - YawTolerance && YawOffset <= FMath::Max(YawSweep, 0.0f) + YawTolerance)
+		{
+			return true;
+		}
+	}
+
+	// The move carrying the aim the shot was fired with may still be on its way.
+	bOutAwaitingView = true;
+	return false;
+}
+
 void AInstantWeapon::DealDamage(const FInstantHitInfo& HitInfo)
 {
 	FPointDamageEvent DmgEvent;
@@ -182,58 +486,161 @@ void AInstantWeapon::DealDamage(const FInstantHitInfo& HitInfo)
 	}
 }
 
-bool AInstantWeapon::ServerDidHit_Validate(const FInstantHitInfo& HitInfo)
+bool AInstantWeapon::ServerReportShots_Validate(const TArray<FInstantHitInfo>& Shots)
 {
+	// Oversized reports are truncated rather than disconnecting the client.
 	return true;
 }
 
-void AInstantWeapon::ServerDidHit_Implementation(const FInstantHitInfo& HitInfo)
+void AInstantWeapon::ServerReportShots_Implementation(const TArray<FInstantHitInfo>& Shots)
 {
+	ProcessShots(Shots);
+}
 
-	bool bDoNotifyHit = false;
+bool AInstantWeapon::ServerReportMisses_Validate(const TArray<FInstantHitInfo>& Shots)
+{
+	return true;
+}
 
-	if (HitInfo.HitActor == nullptr)
-	{
-		bDoNotifyHit = true;
-	}
-	else
+void AInstantWeapon::ServerReportMisses_Implementation(const TArray<FInstantHitInfo>& Shots)
+{
+	ProcessShots(Shots);
+}
+
+void AInstantWeapon::ProcessShots(const TArray<FInstantHitInfo>& Shots)
+{
+	// Shots that should be visualized on other clients. Rejected hits are dropped, and waiting ones are notified once applied.
+	TArray<FInstantHitInfo> ShotsToNotify;
+	ShotsToNotify.Reserve(Shots.Num());
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const int32 NumShots = FMath::Min(Shots.Num(), MaxShotsPerReport);
+	int32 DroppedShots = Shots.Num() - NumShots;
+
+	for (int32 Index = 0; Index < NumShots; ++Index)
 	{
-		if (ValidateHit(HitInfo))
+		const FInstantHitInfo& HitInfo = Shots[Index];
+		// Shots over the fire rate are dropped before doing any work for them.
+		if (!ShotTokenBucket.TryConsume(Now))
 		{
-			DealDamage(HitInfo);
-			bDoNotifyHit = true;
+			++DroppedShots;
 		}
-		else
+		else if (!HitInfo.bDidHit || HitInfo.HitActor == nullptr)
+		{
+			ShotsToNotify.Add(HitInfo);
+		}
+		else if (ProcessHit(HitInfo, Now + ViewArrivalTolerance))
 		{
-			UE_LOG(LogGDK, Verbose, TEXT("%s server: rejected hit of actor %s"), *this->GetName(), *HitInfo.HitActor->GetName());
+			ShotsToNotify.Add(HitInfo);
 		}
 	}
 
-	if (bDoNotifyHit)
+	if (DroppedShots > 0)
 	{
-		NotifyClientsOfHit(HitInfo, true);
+		DroppedShotCount += DroppedShots;
+		INC_DWORD_STAT_BY(STAT_GDKDroppedShots, DroppedShots);
+		UE_LOG(LogGDK, Verbose, TEXT("%s server: dropped %d shots over the fire rate or report size (%d in total)"), *this->GetName(), DroppedShots, DroppedShotCount);
 	}
+
+	NotifyClientsOfShots(ShotsToNotify);
 }
 
-bool AInstantWeapon::ServerDidMiss_Validate(const FInstantHitInfo& HitInfo)
+bool AInstantWeapon::ProcessHit(const FInstantHitInfo& HitInfo, float Deadline)
 {
-	return true;
+	// Hits behind one that is waiting wait too, so they are validated in order.
+	if (AwaitingHits.Num() > 0)
+	{
+		FAwaitingHit& Awaiting = AwaitingHits.AddDefaulted_GetRef();
+		Awaiting.HitInfo = HitInfo;
+		Awaiting.Deadline = Deadline;
+		return false;
+	}
+
+	bool bAwaitingView = false;
+	if (ValidateHit(HitInfo, bAwaitingView))
+	{
+		DealDamage(HitInfo);
+		return true;
+	}
+
+	if (bAwaitingView && GetWorld()->GetTimeSeconds() < Deadline)
+	{
+		FAwaitingHit& Awaiting = AwaitingHits.AddDefaulted_GetRef();
+		Awaiting.HitInfo = HitInfo;
+		Awaiting.Deadline = Deadline;
+		GetWorldTimerManager().SetTimerForNextTick(this, &AInstantWeapon::ProcessAwaitingHits);
+		return false;
+	}
+
+	UE_LOG(LogGDK, Verbose, TEXT("%s server: rejected hit of actor %s"), *this->GetName(), *GetNameSafe(HitInfo.HitActor));
+	return false;
 }
 
-void AInstantWeapon::ServerDidMiss_Implementation(const FInstantHitInfo& HitInfo)
+void AInstantWeapon::ProcessAwaitingHits()
 {
-	NotifyClientsOfHit(HitInfo, false);
+	TArray<FAwaitingHit> Hits = MoveTemp(AwaitingHits);
+	AwaitingHits.Reset();
+
+	TArray<FInstantHitInfo> ShotsToNotify;
+	for (const FAwaitingHit& Awaiting : Hits)
+	{
+		// A hit actor destroyed while the hit waited is cleared by garbage collection, and the hit is rejected.
+		if (ProcessHit(Awaiting.HitInfo, Awaiting.Deadline))
+		{
+			ShotsToNotify.Add(Awaiting.HitInfo);
+		}
+	}
+
+	NotifyClientsOfShots(ShotsToNotify);
 }
 
-void AInstantWeapon::MulticastNotifyHit_Implementation(FInstantHitInfo HitInfo, bool bImpact)
+void AInstantWeapon::PlayShotVisualization(const FShotVisualization& Shot)
 {
-	// Make sure we're a client, and we're not the client that owns this gun (they will have already played the effect locally).
+	// Shots from before the weapon became relevant, or delayed by a long hitch, are stale.
+	if (GetServerWorldTimeSeconds() - Shot.ServerTime > ShotVisualizationDelayTolerance.GetTotalSeconds())
+	{
+		return;
+	}
+
 	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Pawn == nullptr || !Pawn->IsLocallyControlled())
+	{
+		SpawnFX(Shot.HitInfo, Shot.HitInfo.bDidHit);
+	}
+}
+
+void FShotVisualizationRing::AddShot(const FInstantHitInfo& HitInfo, float ServerTime, int32 Capacity)
+{
+	if (Items.Num() < Capacity)
+	{
+		NextSlot = Items.AddDefaulted();
+	}
+	else
+	{
+		NextSlot %= Items.Num();
+	}
+
+	FShotVisualization& Shot = Items[NextSlot];
+	Shot.HitInfo = HitInfo;
+	Shot.ServerTime = ServerTime;
+	MarkItemDirty(Shot);
+
+	++NextSlot;
+}
 
-	if (GetNetMode() != NM_DedicatedServer &&
-		(Pawn == nullptr || !Pawn->IsLocallyControlled()))
+void FShotVisualization::PostReplicatedAdd(const FShotVisualizationRing& InArraySerializer)
+{
+	if (InArraySerializer.Weapon != nullptr)
+	{
+		InArraySerializer.Weapon->PlayShotVisualization(*this);
+	}
+}
+
+void FShotVisualization::PostReplicatedChange(const FShotVisualizationRing& InArraySerializer)
+{
+	if (InArraySerializer.Weapon != nullptr)
 	{
-		SpawnFX(HitInfo, bImpact);
+		InArraySerializer.Weapon->PlayShotVisualization(*this);
 	}
 }
 
@@ -242,4 +649,5 @@ void AInstantWeapon::SetIsActive(bool bNewActive)
 	Super::SetIsActive(bNewActive);
 
 	ConsumeBufferedShot();
+	FlushShotReports();
 }
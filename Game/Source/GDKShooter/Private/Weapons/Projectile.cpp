@@ -4,14 +4,19 @@
 #include "Kismet/GameplayStatics.h"
 #include "Components/StaticMeshComponent.h"
 #include "Engine/World.h"
+#include "GameFramework/DamageableGrid.h"
+#include "GameFramework/GameStateBase.h"
 #include "GameFramework/Pawn.h"
 #include "GDKLogging.h"
 #include "UnrealNetwork.h"
+#include "Weapons/ProjectilePool.h"
+#include "Weapons/ProjectileWeapon.h"
+#include "Weapons/ProjectileSimulation.h"
 
 AProjectile::AProjectile(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
-	PrimaryActorTick.bCanEverTick = true;
-	PrimaryActorTick.TickGroup = TG_PrePhysics;
+	// Lifetimes run on the timer wheel.
+	PrimaryActorTick.bCanEverTick = false;
 
 	bReplicates = true;
 	bReplicateMovement = true;
@@ -40,6 +45,14 @@ AProjectile::AProjectile(const FObjectInitializer& ObjectInitializer) : Super(Ob
 	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("VisibleMesh"));
 	Mesh->SetupAttachment(RootComponent);
 	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	OwningPool = nullptr;
+	bPooled = false;
+	bIdle = false;
+	DamageableGrid = nullptr;
+	TimerExpiryTime = 0.0f;
+	TimerRemaining = 0.0f;
+	TimerWheel = nullptr;
 }
 
 void AProjectile::PostInitializeComponents()
@@ -49,7 +62,118 @@ void AProjectile::PostInitializeComponents()
 	MovementComp->OnProjectileStop.AddDynamic(this, &AProjectile::OnStop);
 	MovementComp->OnProjectileBounce.AddDynamic(this, &AProjectile::OnBounce);
 	CollisionComp->OnComponentBeginOverlap.AddDynamic(this, &AProjectile::BeginOverlap);
-	BeginTime = UGameplayStatics::GetRealTimeSeconds(GetWorld());
+
+	if (bReplicateFlightEvents)
+	{
+		bReplicateMovement = false;
+	}
+}
+
+void AProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bCosmeticExplosion)
+	{
+		MovementComp->StopMovementImmediately();
+		bExploded = true;
+		ExplosionVisuals();
+		SetLifeSpan(LingerAfterExplode);
+		return;
+	}
+
+	// Projectiles can be damaged too, e.g. sticky grenades set each other off, so servers keep them with the other damageable actors.
+	if (!bCosmetic && GetNetMode() != NM_Client)
+	{
+		if (ADamageableGrid* Grid = AGDKWorldManager::Get<ADamageableGrid>(this))
+		{
+			Grid->Register(this);
+		}
+	}
+
+	// Unless authority was already gained, and the lifetime picked up, before beginning play.
+	if (HasAuthority() && TimerWheel == nullptr)
+	{
+		TimerWheel = AGDKWorldManager::Get<ATimerWheelManager>(this);
+
+		if (!bCosmetic)
+		{
+			DamageableGrid = AGDKWorldManager::Get<ADamageableGrid>(this);
+		}
+
+		if (bIdle)
+		{
+			Deactivate();
+		}
+		else
+		{
+			RecordFlightEvent();
+			ScheduleExplosion(LifeTillExplode);
+		}
+	}
+}
+
+void AProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ADamageableGrid* Grid = AGDKWorldManager::Find<ADamageableGrid>(this))
+	{
+		Grid->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AProjectile::OnAuthorityGained()
+{
+	Super::OnAuthorityGained();
+
+	// Timers and the damage grid belong to the server that had authority, so pick up where it left off on this one.
+	if (TimerWheel == nullptr)
+	{
+		TimerWheel = AGDKWorldManager::Get<ATimerWheelManager>(this);
+		if (!bCosmetic)
+		{
+			DamageableGrid = AGDKWorldManager::Get<ADamageableGrid>(this);
+		}
+
+		if (bExploded)
+		{
+			TimerExpiryTime = GetWorld()->GetTimeSeconds() + TimerRemaining;
+			ReleaseHandle = TimerWheel->SetTimer(TimerRemaining, FSimpleDelegate::CreateUObject(this, &AProjectile::ReturnToPool));
+		}
+		else if (!bIdle)
+		{
+			ScheduleExplosion(TimerRemaining);
+		}
+	}
+
+	// The previous server's pool stays behind, so a pooled projectile joins this server's pool instead.
+	if (bPooled && OwningPool == nullptr)
+	{
+		OwningPool = AGDKWorldManager::Get<AProjectilePool>(this);
+		if (OwningPool != nullptr)
+		{
+			OwningPool->Adopt(this);
+		}
+	}
+}
+
+void AProjectile::OnAuthorityLost()
+{
+	if (TimerWheel != nullptr)
+	{
+		TimerWheel->ClearTimer(LifetimeHandle);
+		TimerWheel->ClearTimer(ReleaseHandle);
+		TimerWheel = nullptr;
+	}
+
+	if (OwningPool != nullptr)
+	{
+		OwningPool->Forget(this);
+		OwningPool = nullptr;
+	}
+
+	Super::OnAuthorityLost();
 }
 
 void AProjectile::SetPlayer(AWeapon* Weapon)
@@ -69,6 +193,8 @@ void AProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifet
 
 	DOREPLIFETIME(AProjectile, bExploded);
 	DOREPLIFETIME(AProjectile, MetaData);
+	DOREPLIFETIME(AProjectile, FlightEvent);
+	DOREPLIFETIME(AProjectile, Prediction);
 }
 
 void AProjectile::PostNetReceiveVelocity(const FVector& NewVelocity)
@@ -79,24 +205,146 @@ void AProjectile::PostNetReceiveVelocity(const FVector& NewVelocity)
 	}
 }
 
+float AProjectile::GetServerWorldTimeSeconds() const
+{
+	if (AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		return GameState->GetServerWorldTimeSeconds();
+	}
+	return GetWorld()->GetTimeSeconds();
+}
+
+void AProjectile::RecordFlightEvent()
+{
+	if (!bReplicateFlightEvents)
+	{
+		return;
+	}
+
+	FlightEvent.Location = GetActorLocation();
+	FlightEvent.Velocity = MovementComp->Velocity;
+	FlightEvent.ServerTime = GetServerWorldTimeSeconds();
+}
+
+void AProjectile::OnRep_FlightEvent()
+{
+	if (FlightEvent.Velocity.IsZero())
+	{
+		MovementComp->StopMovementImmediately();
+		SetActorLocation(FlightEvent.Location);
+		return;
+	}
+
+	// Follow the ballistic path from the event to now. Sweep, so latency doesn't carry the projectile through walls.
+	const float Elapsed = FMath::Clamp(GetServerWorldTimeSeconds() - FlightEvent.ServerTime, 0.0f, LifeTillExplode);
+	const float GravityZ = MovementComp->GetGravityZ();
+	const FVector Location = FlightEvent.Location + FlightEvent.Velocity * Elapsed + FVector(0.0f, 0.0f, 0.5f * GravityZ * Elapsed * Elapsed);
+	const FVector Velocity = FlightEvent.Velocity + FVector(0.0f, 0.0f, GravityZ * Elapsed);
+
+	// A stop clears the updated component, so restart the local simulation if an earlier event stopped it.
+	if (MovementComp->UpdatedComponent == nullptr)
+	{
+		MovementComp->SetUpdatedComponent(CollisionComp);
+	}
+	SetActorLocation(FlightEvent.Location);
+	SetActorLocation(Location, true);
+	MovementComp->Velocity = Velocity;
+	MovementComp->UpdateComponentVelocity();
+}
+
+void AProjectile::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	if (LifetimeHandle.IsValid() || ReleaseHandle.IsValid())
+	{
+		TimerRemaining = FMath::Max(TimerExpiryTime - GetWorld()->GetTimeSeconds(), 0.0f);
+	}
+}
+
+void AProjectile::MakeIdle()
+{
+	bIdle = true;
+	bCanBeDamaged = false;
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void AProjectile::MakeCosmetic()
+{
+	bCosmetic = true;
+	SetReplicates(false);
+}
+
+void AProjectile::MakeCosmeticExplosion()
+{
+	MakeCosmetic();
+	bCosmeticExplosion = true;
+	SetActorEnableCollision(false);
+}
+
+void AProjectile::FastForward(float Seconds, float MaxStepTime)
+{
+	ScheduleExplosion(LifeTillExplode - Seconds);
+
+	// Stepping the movement sweeps, bounces and overlaps exactly as ticking would, so impacts during the catch-up still count.
+	const float StepTime = FMath::Max(MaxStepTime, KINDA_SMALL_NUMBER);
+	while (Seconds > KINDA_SMALL_NUMBER && !bExploded && MovementComp->UpdatedComponent != nullptr)
+	{
+		const float DeltaTime = FMath::Min(Seconds, StepTime);
+		MovementComp->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+		Seconds -= DeltaTime;
+	}
+
+	if (!bExploded)
+	{
+		RecordFlightEvent();
+	}
+}
+
+void AProjectile::SetPrediction(AWeapon* Weapon, int32 PredictionId)
+{
+	Prediction.Weapon = Weapon;
+	Prediction.Id = PredictionId;
+}
+
+void AProjectile::OnRep_Prediction()
+{
+	if (Prediction.Id == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (AProjectileWeapon* Weapon = Cast<AProjectileWeapon>(Prediction.Weapon))
+	{
+		Weapon->ReconcilePredictedProjectile(Prediction.Id);
+	}
+}
+
 void AProjectile::OnRep_MetaData()
 {
 	OnMetaDataUpdated();
 }
 
-void AProjectile::Tick(float DeltaTime)
+void AProjectile::ScheduleExplosion(float Delay)
 {
-	if (!HasAuthority())
+	if (TimerWheel == nullptr)
 	{
 		return;
 	}
-	
-	float Now = UGameplayStatics::GetRealTimeSeconds(GetWorld());
-	if (!bExploded && Now > BeginTime + LifeTillExplode)
+
+	TimerWheel->ClearTimer(LifetimeHandle);
+	TimerExpiryTime = GetWorld()->GetTimeSeconds() + Delay;
+	LifetimeHandle = TimerWheel->SetTimer(Delay, FSimpleDelegate::CreateUObject(this, &AProjectile::OnLifetimeExpired));
+}
+
+void AProjectile::OnLifetimeExpired()
+{
+	LifetimeHandle.Invalidate();
+	if (!bExploded)
 	{
 		Explode();
 	}
-
 }
 
 void AProjectile::OnStop(const FHitResult& ImpactResult)
@@ -106,6 +354,8 @@ void AProjectile::OnStop(const FHitResult& ImpactResult)
 		return;
 	}
 
+	RecordFlightEvent();
+
 	if (ExplodeOnStop && !bExploded)
 	{
 		Explode();
@@ -119,6 +369,8 @@ void AProjectile::OnBounce(const FHitResult& ImpactResult, const FVector& Impact
 		return;
 	}
 
+	RecordFlightEvent();
+
 	BouncesSoFar++;
 	if (MaximumBounces >= 0 && BouncesSoFar > MaximumBounces && !bExploded)
 	{
@@ -146,7 +398,14 @@ void AProjectile::OverlapPawn_Implementation(APawn* OtherPawn)
 
 void AProjectile::OnRep_Exploded()
 {
-	ExplosionVisuals();
+	if (bExploded)
+	{
+		ExplosionVisuals();
+	}
+	else
+	{
+		ResetVisuals();
+	}
 }
 
 void AProjectile::ExplosionVisuals_Implementation()
@@ -154,9 +413,103 @@ void AProjectile::ExplosionVisuals_Implementation()
 	Mesh->SetVisibility(false, true);
 }
 
+void AProjectile::ResetVisuals_Implementation()
+{
+	Mesh->SetVisibility(true, true);
+}
+
+void AProjectile::ResetForLaunch()
+{
+	if (TimerWheel != nullptr)
+	{
+		TimerWheel->ClearTimer(ReleaseHandle);
+	}
+
+	bIdle = false;
+	bExploded = false;
+	bCanBeDamaged = GetDefault<AProjectile>(GetClass())->bCanBeDamaged;
+	BouncesSoFar = 0;
+	ScheduleExplosion(LifeTillExplode);
+	MetaData = FGDKMetaData();
+	Prediction = FProjectilePrediction();
+	InstigatingController = nullptr;
+	InstigatingWeapon = nullptr;
+	CollisionComp->MoveIgnoreActors.Reset();
+	CollisionComp->MoveIgnoreActors.Add(Instigator);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	ResetVisuals();
+
+	// Stopping clears the updated component, so restart the movement as on spawn.
+	MovementComp->SetUpdatedComponent(CollisionComp);
+	MovementComp->Velocity = GetActorForwardVector() * MovementComp->InitialSpeed;
+	MovementComp->UpdateComponentVelocity();
+
+	RecordFlightEvent();
+}
+
+void AProjectile::Deactivate()
+{
+	if (TimerWheel != nullptr)
+	{
+		TimerWheel->ClearTimer(LifetimeHandle);
+		TimerWheel->ClearTimer(ReleaseHandle);
+	}
+
+	bIdle = true;
+	bCanBeDamaged = false;
+	MovementComp->StopMovementImmediately();
+	MovementComp->SetUpdatedComponent(nullptr);
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void AProjectile::GetSimulatedClass(FSimulatedProjectileClass& OutClass) const
+{
+	OutClass.Mesh = Mesh->GetStaticMesh();
+	OutClass.Materials = Mesh->OverrideMaterials;
+	OutClass.MeshTransform = Mesh->GetRelativeTransform();
+
+	OutClass.CollisionChannel = CollisionComp->GetCollisionObjectType();
+	OutClass.CollisionResponses = CollisionComp->GetCollisionResponseToChannels();
+	OutClass.Radius = CollisionComp->GetUnscaledSphereRadius();
+
+	OutClass.InitialSpeed = MovementComp->InitialSpeed;
+	OutClass.GravityScale = MovementComp->ProjectileGravityScale;
+	OutClass.bShouldBounce = MovementComp->bShouldBounce;
+	OutClass.Bounciness = MovementComp->Bounciness;
+	OutClass.Friction = MovementComp->Friction;
+	OutClass.StopSpeed = MovementComp->BounceVelocityStopSimulatingThreshold;
+
+	OutClass.bExplodeOnStop = ExplodeOnStop;
+	OutClass.MaximumBounces = MaximumBounces;
+	OutClass.LifeTillExplode = LifeTillExplode;
+
+	OutClass.ExplosionDamage = ExplosionDamage;
+	OutClass.ExplosionMinimumDamage = ExplosionMinimumDamage;
+	OutClass.ExplosionRadius = ExplosionRadius;
+	OutClass.ExplosionInnerRadius = ExplosionInnerRadius;
+	OutClass.ExplosionFalloff = ExplosionFalloff;
+	OutClass.DamageTypeClass = DamageTypeClass;
+}
+
+void AProjectile::ReturnToPool()
+{
+	if (OwningPool != nullptr)
+	{
+		OwningPool->Release(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
 void AProjectile::Explode()
 {
-	if (!HasAuthority())
+	// A lingering projectile can still be overlapped, and exploding again would rearm its release.
+	if (!HasAuthority() || bExploded)
 	{
 		return;
 	}
@@ -164,9 +517,34 @@ void AProjectile::Explode()
 	bCanBeDamaged = false;
 	bExploded = true;
 	MovementComp->StopMovementImmediately();
-	SetLifeSpan(2.0f);
+
+	// The authoritative projectile plays the explosion, so a cosmetic one just disappears.
+	if (bCosmetic)
+	{
+		Destroy();
+		return;
+	}
+
+	RecordFlightEvent();
+	if (TimerWheel != nullptr)
+	{
+		TimerWheel->ClearTimer(LifetimeHandle);
+		TimerExpiryTime = GetWorld()->GetTimeSeconds() + LingerAfterExplode;
+		ReleaseHandle = TimerWheel->SetTimer(LingerAfterExplode, FSimpleDelegate::CreateUObject(this, &AProjectile::ReturnToPool));
+	}
+	else
+	{
+		SetLifeSpan(LingerAfterExplode);
+	}
 	if (ExplosionDamage > 0 && ExplosionRadius > 0)
 	{
-		UGameplayStatics::ApplyRadialDamageWithFalloff(this, ExplosionDamage, ExplosionMinimumDamage, this->GetActorLocation(), ExplosionInnerRadius, ExplosionRadius, ExplosionFalloff, DamageTypeClass, TArray<AActor*>{this}, this, InstigatingController);
+		if (DamageableGrid != nullptr)
+		{
+			DamageableGrid->ApplyRadialDamageWithFalloff(ExplosionDamage, ExplosionMinimumDamage, GetActorLocation(), ExplosionInnerRadius, ExplosionRadius, ExplosionFalloff, DamageTypeClass, TArray<AActor*>{this}, this, InstigatingController);
+		}
+		else
+		{
+			UGameplayStatics::ApplyRadialDamageWithFalloff(this, ExplosionDamage, ExplosionMinimumDamage, this->GetActorLocation(), ExplosionInnerRadius, ExplosionRadius, ExplosionFalloff, DamageTypeClass, TArray<AActor*>{this}, this, InstigatingController);
+		}
 	}
 }
@@ -0,0 +1,170 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "ProjectilePool.h"
+
+#include "Engine/World.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Weapons/Projectile.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("ProjectilePoolHits"), STAT_GDKProjectilePoolHits, STATGROUP_GDKShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("ProjectilePoolMisses"), STAT_GDKProjectilePoolMisses, STATGROUP_GDKShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("ProjectilesInUse"), STAT_GDKProjectilesInUse, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectilePoolStatsCommand(
+	TEXT("GDK.ProjectilePoolStats"),
+	TEXT("Logs projectile pool hits, misses and high-water marks for each projectile class."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&AProjectilePool::LogStats));
+
+void AProjectilePool::Prewarm(TSubclassOf<AProjectile> ProjectileClass, int32 Count)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return;
+	}
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+	while (Bucket.Free.Num() + Bucket.InUse < Count)
+	{
+		AProjectile* Projectile = SpawnProjectile(ProjectileClass, GetActorTransform(), nullptr, FGDKMetaData(), true);
+		if (Projectile == nullptr)
+		{
+			return;
+		}
+		Bucket.Free.Add(Projectile);
+	}
+}
+
+AProjectile* AProjectilePool::Launch(TSubclassOf<AProjectile> ProjectileClass, const FTransform& Transform, AWeapon* Weapon, const FGDKMetaData& MetaData)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+
+	// Idle projectiles can be destroyed under us, for example when streaming out a level.
+	AProjectile* Projectile = nullptr;
+	while (Projectile == nullptr && Bucket.Free.Num() > 0)
+	{
+		Projectile = Bucket.Free.Pop(false);
+		if (Projectile != nullptr && (Projectile->IsPendingKill() || !Projectile->HasAuthority()))
+		{
+			Projectile = nullptr;
+		}
+	}
+
+	if (Projectile != nullptr)
+	{
+		++Bucket.Hits;
+		INC_DWORD_STAT(STAT_GDKProjectilePoolHits);
+		Projectile->SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+		Projectile->ResetForLaunch();
+		Projectile->SetPlayer(Weapon);
+		Projectile->MetaData = MetaData;
+	}
+	else
+	{
+		++Bucket.Misses;
+		INC_DWORD_STAT(STAT_GDKProjectilePoolMisses);
+		Projectile = SpawnProjectile(ProjectileClass, Transform, Weapon, MetaData);
+		if (Projectile == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	++Bucket.InUse;
+	Bucket.HighWater = FMath::Max(Bucket.HighWater, Bucket.InUse);
+	INC_DWORD_STAT(STAT_GDKProjectilesInUse);
+	return Projectile;
+}
+
+void AProjectilePool::Release(AProjectile* Projectile)
+{
+	if (Projectile->bIdle)
+	{
+		return;
+	}
+
+	FProjectilePoolBucket* Bucket = Buckets.Find(Projectile->GetClass());
+	if (Bucket == nullptr)
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->Deactivate();
+	Bucket->Free.Add(Projectile);
+	--Bucket->InUse;
+	DEC_DWORD_STAT(STAT_GDKProjectilesInUse);
+}
+
+void AProjectilePool::Adopt(AProjectile* Projectile)
+{
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(Projectile->GetClass());
+	if (Projectile->bIdle)
+	{
+		Bucket.Free.AddUnique(Projectile);
+		return;
+	}
+
+	++Bucket.InUse;
+	Bucket.HighWater = FMath::Max(Bucket.HighWater, Bucket.InUse);
+	INC_DWORD_STAT(STAT_GDKProjectilesInUse);
+}
+
+void AProjectilePool::Forget(AProjectile* Projectile)
+{
+	FProjectilePoolBucket* Bucket = Buckets.Find(Projectile->GetClass());
+	if (Bucket == nullptr || Bucket->Free.Remove(Projectile) > 0)
+	{
+		return;
+	}
+
+	--Bucket->InUse;
+	DEC_DWORD_STAT(STAT_GDKProjectilesInUse);
+}
+
+AProjectile* AProjectilePool::SpawnProjectile(UClass* ProjectileClass, const FTransform& Transform, AWeapon* Weapon, const FGDKMetaData& MetaData, bool bIdle)
+{
+	AProjectile* Projectile = Cast<AProjectile>(UGameplayStatics::BeginDeferredActorSpawnFromClass(this, ProjectileClass, Transform));
+	if (Projectile == nullptr)
+	{
+		return nullptr;
+	}
+
+	Projectile->OwningPool = this;
+	Projectile->bPooled = true;
+	if (bIdle)
+	{
+		Projectile->MakeIdle();
+	}
+	if (Weapon != nullptr)
+	{
+		Projectile->SetPlayer(Weapon);
+	}
+	Projectile->MetaData = MetaData;
+	UGameplayStatics::FinishSpawningActor(Projectile, Transform);
+	return Projectile;
+}
+
+void AProjectilePool::LogStats(const TArray<FString>& Args, UWorld* World)
+{
+	AProjectilePool* Pool = AGDKWorldManager::Find<AProjectilePool>(World);
+	if (Pool == nullptr)
+	{
+		UE_LOG(LogGDK, Display, TEXT("GDK.ProjectilePoolStats: no projectile pool in this world."));
+		return;
+	}
+
+	for (const TPair<UClass*, FProjectilePoolBucket>& Pair : Pool->Buckets)
+	{
+		const FProjectilePoolBucket& Bucket = Pair.Value;
+		UE_LOG(LogGDK, Display, TEXT("GDK.ProjectilePoolStats: %s: %d hits, %d misses, %d in use, %d idle, high-water %d"),
+			*GetNameSafe(Pair.Key), Bucket.Hits, Bucket.Misses, Bucket.InUse, Bucket.Free.Num(), Bucket.HighWater);
+	}
+}
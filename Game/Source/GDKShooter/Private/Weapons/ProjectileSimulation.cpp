@@ -0,0 +1,443 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "ProjectileSimulation.h"
+
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/DamageableGrid.h"
+#include "GameFramework/Pawn.h"
+#include "GDKLogging.h"
+#include "GDKStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Weapons/Projectile.h"
+#include "Weapons/ProjectileWeapon.h"
+
+DECLARE_CYCLE_STAT(TEXT("SimulateProjectiles"), STAT_GDKSimulateProjectiles, STATGROUP_GDKShooter);
+DECLARE_CYCLE_STAT(TEXT("SweepProjectiles"), STAT_GDKSweepProjectiles, STATGROUP_GDKShooter);
+DECLARE_CYCLE_STAT(TEXT("UpdateProjectileVisuals"), STAT_GDKUpdateProjectileVisuals, STATGROUP_GDKShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("SimulatedProjectiles"), STAT_GDKSimulatedProjectiles, STATGROUP_GDKShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkProjectilesCommand(
+	TEXT("GDK.BenchmarkProjectiles"),
+	TEXT("Times the projectile simulation with N cosmetic projectiles. Usage: GDK.BenchmarkProjectiles [N]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&AProjectileSimulation::RunBenchmark));
+
+namespace
+{
+	// Projectiles at most this big are traced as lines rather than swept as spheres.
+	const float LineTraceRadius = 1.0f;
+
+	// Distance a bounced projectile is pushed off the surface it hit.
+	const float BounceSeparation = 0.1f;
+
+	template<typename ArrayType>
+	void RemoveLaneAtSwap(ArrayType& Lanes, int32 Index)
+	{
+		Lanes.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+AProjectileSimulation::AProjectileSimulation()
+	: NextId(0)
+	, DamageableGrid(nullptr)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+int32 AProjectileSimulation::FindOrAddClass(UClass* ProjectileClass)
+{
+	for (int32 ClassIndex = 0; ClassIndex < Classes.Num(); ++ClassIndex)
+	{
+		if (Classes[ClassIndex].ProjectileClass == ProjectileClass)
+		{
+			return ClassIndex;
+		}
+	}
+
+	FSimulatedProjectileClass& SimulatedClass = Classes.AddDefaulted_GetRef();
+	GetDefault<AProjectile>(ProjectileClass)->GetSimulatedClass(SimulatedClass);
+	SimulatedClass.ProjectileClass = ProjectileClass;
+	ClassTransforms.AddDefaulted();
+
+	if (GetNetMode() != NM_DedicatedServer && SimulatedClass.Mesh != nullptr)
+	{
+		SimulatedClass.Instances = NewObject<UInstancedStaticMeshComponent>(this);
+		SimulatedClass.Instances->SetMobility(EComponentMobility::Movable);
+		SimulatedClass.Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		SimulatedClass.Instances->SetStaticMesh(SimulatedClass.Mesh);
+		for (int32 MaterialIndex = 0; MaterialIndex < SimulatedClass.Materials.Num(); ++MaterialIndex)
+		{
+			SimulatedClass.Instances->SetMaterial(MaterialIndex, SimulatedClass.Materials[MaterialIndex]);
+		}
+		SimulatedClass.Instances->SetupAttachment(RootComponent);
+		SimulatedClass.Instances->RegisterComponent();
+	}
+
+	return Classes.Num() - 1;
+}
+
+int32 AProjectileSimulation::SpawnProjectile(TSubclassOf<AProjectile> ProjectileClass, const FVector& Origin, const FVector& Direction, AProjectileWeapon* Weapon, int32 Id, float FastForward)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	if (Id == INDEX_NONE)
+	{
+		Id = NextId;
+		NextId = (NextId + 1) & MAX_int32;
+
+		// Clients only allocate ids for predicted projectiles. Keep them negative so they never collide with the server's.
+		if (GetNetMode() == NM_Client)
+		{
+			Id = -2 - Id;
+		}
+	}
+
+	const int32 ClassIndex = FindOrAddClass(ProjectileClass);
+	const FSimulatedProjectileClass& SimulatedClass = Classes[ClassIndex];
+
+	// Catch up on the time the spawn took to arrive, along the same analytic path as Simulate.
+	const float Gravity = GetWorld()->GetGravityZ() * SimulatedClass.GravityScale;
+	const FVector Velocity = Direction.GetSafeNormal() * SimulatedClass.InitialSpeed;
+	const float Elapsed = FMath::Max(FastForward, 0.0f);
+	const FVector Position = Origin + Velocity * Elapsed + FVector(0.0f, 0.0f, 0.5f * Gravity * Elapsed * Elapsed);
+
+	PositionX.Add(Position.X);
+	PositionY.Add(Position.Y);
+	PositionZ.Add(Position.Z);
+	VelocityX.Add(Velocity.X);
+	VelocityY.Add(Velocity.Y);
+	VelocityZ.Add(Velocity.Z + Gravity * Elapsed);
+	GravityZ.Add(Gravity);
+	PreviousX.Add(Position.X);
+	PreviousY.Add(Position.Y);
+	PreviousZ.Add(Position.Z);
+	ExplodeTimes.Add(GetWorld()->GetTimeSeconds() + SimulatedClass.LifeTillExplode - Elapsed);
+	Bounces.Add(0);
+	ClassIndices.Add(ClassIndex);
+	Ids.Add(Id);
+	bResting.Add(false);
+	Weapons.Add(Weapon);
+	IgnoredActors.Add(Weapon != nullptr ? Weapon->GetOwner() : nullptr);
+	IdToIndex.Add(Id, Ids.Num() - 1);
+
+	SetActorTickEnabled(true);
+	return Id;
+}
+
+bool AProjectileSimulation::RemoveProjectile(int32 Id, FVector& OutLocation)
+{
+	const int32* Index = IdToIndex.Find(Id);
+	if (Index == nullptr)
+	{
+		return false;
+	}
+
+	OutLocation = FVector(PositionX[*Index], PositionY[*Index], PositionZ[*Index]);
+	RemoveAt(*Index);
+	return true;
+}
+
+void AProjectileSimulation::RemoveAt(int32 Index)
+{
+	IdToIndex.Remove(Ids[Index]);
+
+	RemoveLaneAtSwap(PositionX, Index);
+	RemoveLaneAtSwap(PositionY, Index);
+	RemoveLaneAtSwap(PositionZ, Index);
+	RemoveLaneAtSwap(VelocityX, Index);
+	RemoveLaneAtSwap(VelocityY, Index);
+	RemoveLaneAtSwap(VelocityZ, Index);
+	RemoveLaneAtSwap(GravityZ, Index);
+	RemoveLaneAtSwap(PreviousX, Index);
+	RemoveLaneAtSwap(PreviousY, Index);
+	RemoveLaneAtSwap(PreviousZ, Index);
+	RemoveLaneAtSwap(ExplodeTimes, Index);
+	RemoveLaneAtSwap(Bounces, Index);
+	RemoveLaneAtSwap(ClassIndices, Index);
+	RemoveLaneAtSwap(Ids, Index);
+	RemoveLaneAtSwap(bResting, Index);
+	RemoveLaneAtSwap(Weapons, Index);
+	RemoveLaneAtSwap(IgnoredActors, Index);
+
+	if (Index < Ids.Num())
+	{
+		IdToIndex.Add(Ids[Index], Index);
+	}
+}
+
+void AProjectileSimulation::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Simulate(DeltaTime);
+
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		UpdateVisuals();
+	}
+
+	SET_DWORD_STAT(STAT_GDKSimulatedProjectiles, Ids.Num());
+
+	if (Ids.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void AProjectileSimulation::Simulate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKSimulateProjectiles);
+
+	const int32 NumProjectiles = Ids.Num();
+	if (NumProjectiles == 0)
+	{
+		return;
+	}
+
+	FMemory::Memcpy(PreviousX.GetData(), PositionX.GetData(), NumProjectiles * sizeof(float));
+	FMemory::Memcpy(PreviousY.GetData(), PositionY.GetData(), NumProjectiles * sizeof(float));
+	FMemory::Memcpy(PreviousZ.GetData(), PositionZ.GetData(), NumProjectiles * sizeof(float));
+
+	// Constant acceleration, so p += v t + g t^2 / 2 is exact for any step length.
+	const VectorRegister StepTime = VectorSetFloat1(DeltaTime);
+	const VectorRegister HalfStepTimeSq = VectorSetFloat1(0.5f * DeltaTime * DeltaTime);
+	const int32 NumVectorized = NumProjectiles & ~3;
+
+	for (int32 Index = 0; Index < NumVectorized; Index += 4)
+	{
+		const VectorRegister VX = VectorLoadAligned(&VelocityX[Index]);
+		const VectorRegister VY = VectorLoadAligned(&VelocityY[Index]);
+		const VectorRegister VZ = VectorLoadAligned(&VelocityZ[Index]);
+		const VectorRegister G = VectorLoadAligned(&GravityZ[Index]);
+
+		VectorStoreAligned(VectorMultiplyAdd(VX, StepTime, VectorLoadAligned(&PositionX[Index])), &PositionX[Index]);
+		VectorStoreAligned(VectorMultiplyAdd(VY, StepTime, VectorLoadAligned(&PositionY[Index])), &PositionY[Index]);
+		VectorStoreAligned(VectorMultiplyAdd(G, HalfStepTimeSq, VectorMultiplyAdd(VZ, StepTime, VectorLoadAligned(&PositionZ[Index]))), &PositionZ[Index]);
+		VectorStoreAligned(VectorMultiplyAdd(G, StepTime, VZ), &VelocityZ[Index]);
+	}
+
+	for (int32 Index = NumVectorized; Index < NumProjectiles; ++Index)
+	{
+		PositionX[Index] += VelocityX[Index] * DeltaTime;
+		PositionY[Index] += VelocityY[Index] * DeltaTime;
+		PositionZ[Index] += VelocityZ[Index] * DeltaTime + 0.5f * GravityZ[Index] * DeltaTime * DeltaTime;
+		VelocityZ[Index] += GravityZ[Index] * DeltaTime;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_GDKSweepProjectiles);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// Backwards, so that swapping a removed projectile with the last one only moves projectiles already handled.
+	for (int32 Index = NumProjectiles - 1; Index >= 0; --Index)
+	{
+		if (Now >= ExplodeTimes[Index])
+		{
+			Explode(Index);
+			continue;
+		}
+
+		if (bResting[Index])
+		{
+			continue;
+		}
+
+		const FSimulatedProjectileClass& SimulatedClass = Classes[ClassIndices[Index]];
+		const FVector Start(PreviousX[Index], PreviousY[Index], PreviousZ[Index]);
+		const FVector End(PositionX[Index], PositionY[Index], PositionZ[Index]);
+
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(GDKSimulatedProjectile), false, IgnoredActors[Index].Get());
+		const FCollisionResponseParams ResponseParams(SimulatedClass.CollisionResponses);
+		FHitResult Hit;
+		const bool bHit = SimulatedClass.Radius <= LineTraceRadius
+			? GetWorld()->LineTraceSingleByChannel(Hit, Start, End, SimulatedClass.CollisionChannel, Params, ResponseParams)
+			: GetWorld()->SweepSingleByChannel(Hit, Start, End, FQuat::Identity, SimulatedClass.CollisionChannel, FCollisionShape::MakeSphere(SimulatedClass.Radius), Params, ResponseParams);
+		if (!bHit)
+		{
+			continue;
+		}
+
+		// Pawns are hit directly.
+		if (Cast<APawn>(Hit.GetActor()) != nullptr)
+		{
+			PositionX[Index] = Hit.Location.X;
+			PositionY[Index] = Hit.Location.Y;
+			PositionZ[Index] = Hit.Location.Z;
+			Explode(Index);
+			continue;
+		}
+
+		const FVector Normal = Hit.ImpactNormal;
+		const FVector Resting = Hit.Location + Normal * BounceSeparation;
+		PositionX[Index] = Resting.X;
+		PositionY[Index] = Resting.Y;
+		PositionZ[Index] = Resting.Z;
+
+		FVector Velocity(VelocityX[Index], VelocityY[Index], VelocityZ[Index]);
+		bool bStopped = !SimulatedClass.bShouldBounce;
+		if (SimulatedClass.bShouldBounce)
+		{
+			++Bounces[Index];
+			if (SimulatedClass.MaximumBounces >= 0 && Bounces[Index] > SimulatedClass.MaximumBounces)
+			{
+				Explode(Index);
+				continue;
+			}
+
+			// Reflect the normal part of the velocity with restitution, and slow the tangential part with friction.
+			const FVector NormalVelocity = (Velocity | Normal) * Normal;
+			Velocity = (Velocity - NormalVelocity) * (1.0f - SimulatedClass.Friction) - NormalVelocity * SimulatedClass.Bounciness;
+			bStopped = Velocity.SizeSquared() < FMath::Square(SimulatedClass.StopSpeed);
+		}
+
+		if (bStopped)
+		{
+			if (SimulatedClass.bExplodeOnStop)
+			{
+				Explode(Index);
+				continue;
+			}
+			Velocity = FVector::ZeroVector;
+			GravityZ[Index] = 0.0f;
+			bResting[Index] = true;
+		}
+
+		VelocityX[Index] = Velocity.X;
+		VelocityY[Index] = Velocity.Y;
+		VelocityZ[Index] = Velocity.Z;
+	}
+}
+
+void AProjectileSimulation::Explode(int32 Index)
+{
+	AProjectileWeapon* Weapon = Weapons[Index].Get();
+	// The simulation is a local actor everywhere, so check the net mode rather than authority.
+	if (GetNetMode() != NM_Client && Weapon != nullptr)
+	{
+		const FSimulatedProjectileClass& SimulatedClass = Classes[ClassIndices[Index]];
+		const FVector Location(PositionX[Index], PositionY[Index], PositionZ[Index]);
+
+		if (SimulatedClass.ExplosionDamage > 0 && SimulatedClass.ExplosionRadius > 0)
+		{
+			if (DamageableGrid == nullptr)
+			{
+				DamageableGrid = AGDKWorldManager::Get<ADamageableGrid>(this);
+			}
+
+			APawn* Pawn = Cast<APawn>(Weapon->GetOwner());
+			AController* Controller = Pawn != nullptr ? Pawn->GetController() : nullptr;
+			if (DamageableGrid != nullptr)
+			{
+				DamageableGrid->ApplyRadialDamageWithFalloff(SimulatedClass.ExplosionDamage, SimulatedClass.ExplosionMinimumDamage, Location,
+					SimulatedClass.ExplosionInnerRadius, SimulatedClass.ExplosionRadius, SimulatedClass.ExplosionFalloff, SimulatedClass.DamageTypeClass,
+					TArray<AActor*>(), Weapon, Controller);
+			}
+			else
+			{
+				UGameplayStatics::ApplyRadialDamageWithFalloff(this, SimulatedClass.ExplosionDamage, SimulatedClass.ExplosionMinimumDamage, Location,
+					SimulatedClass.ExplosionInnerRadius, SimulatedClass.ExplosionRadius, SimulatedClass.ExplosionFalloff, SimulatedClass.DamageTypeClass,
+					TArray<AActor*>(), Weapon, Controller);
+			}
+		}
+
+		Weapon->MulticastSimulatedProjectileExploded(Ids[Index], Location);
+	}
+
+	// Clients wait for the server's explosion event to play effects.
+	RemoveAt(Index);
+}
+
+void AProjectileSimulation::UpdateVisuals()
+{
+	SCOPE_CYCLE_COUNTER(STAT_GDKUpdateProjectileVisuals);
+
+	for (TArray<FTransform>& Transforms : ClassTransforms)
+	{
+		Transforms.Reset();
+	}
+
+	for (int32 Index = 0; Index < Ids.Num(); ++Index)
+	{
+		const int32 ClassIndex = ClassIndices[Index];
+		const FVector Velocity(VelocityX[Index], VelocityY[Index], VelocityZ[Index]);
+		const FTransform ProjectileTransform(Velocity.IsNearlyZero() ? FQuat::Identity : Velocity.ToOrientationQuat(), FVector(PositionX[Index], PositionY[Index], PositionZ[Index]));
+		ClassTransforms[ClassIndex].Add(Classes[ClassIndex].MeshTransform * ProjectileTransform);
+	}
+
+	for (int32 ClassIndex = 0; ClassIndex < Classes.Num(); ++ClassIndex)
+	{
+		UInstancedStaticMeshComponent* Instances = Classes[ClassIndex].Instances;
+		if (Instances == nullptr)
+		{
+			continue;
+		}
+
+		const TArray<FTransform>& Transforms = ClassTransforms[ClassIndex];
+		while (Instances->GetInstanceCount() > Transforms.Num())
+		{
+			Instances->RemoveInstance(Instances->GetInstanceCount() - 1);
+		}
+		while (Instances->GetInstanceCount() < Transforms.Num())
+		{
+			Instances->AddInstanceWorldSpace(Transforms[Instances->GetInstanceCount()]);
+		}
+		for (int32 Instance = 0; Instance < Transforms.Num(); ++Instance)
+		{
+			Instances->UpdateInstanceTransform(Instance, Transforms[Instance], true, false, true);
+		}
+		Instances->MarkRenderStateDirty();
+	}
+}
+
+void AProjectileSimulation::RunBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	AProjectileSimulation* Simulation = AGDKWorldManager::Get<AProjectileSimulation>(World);
+	if (Simulation == nullptr)
+	{
+		UE_LOG(LogGDK, Warning, TEXT("GDK.BenchmarkProjectiles: no game world to simulate in."));
+		return;
+	}
+
+	const int32 NumProjectiles = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+	const int32 NumSteps = 60;
+	const float StepTime = 1.0f / 30.0f;
+
+	// Use the class of a projectile already in flight if there is one, so the benchmark uses real meshes and collision.
+	TSubclassOf<AProjectile> ProjectileClass = Simulation->Classes.Num() > 0 ? Simulation->Classes[0].ProjectileClass : AProjectile::StaticClass();
+
+	// Cosmetic projectiles fired upwards from around the world origin.
+	FRandomStream Random(NumProjectiles);
+	TArray<int32> BenchmarkIds;
+	BenchmarkIds.Reserve(NumProjectiles);
+	for (int32 Index = 0; Index < NumProjectiles; ++Index)
+	{
+		const FVector Origin(Random.FRandRange(-5000.0f, 5000.0f), Random.FRandRange(-5000.0f, 5000.0f), 1000.0f);
+		const FVector Direction = Random.VRandCone(FVector::UpVector, PI / 4.0f);
+		BenchmarkIds.Add(Simulation->SpawnProjectile(ProjectileClass, Origin, Direction, nullptr, INDEX_NONE, 0.0f));
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		Simulation->Simulate(StepTime);
+	}
+	const double SimulateSeconds = FPlatformTime::Seconds() - StartTime;
+	const int32 Survivors = Simulation->GetNumProjectiles();
+
+	FVector Location;
+	for (int32 Id : BenchmarkIds)
+	{
+		Simulation->RemoveProjectile(Id, Location);
+	}
+
+	UE_LOG(LogGDK, Display, TEXT("GDK.BenchmarkProjectiles: %d projectiles, %.3f ms per %.0f Hz step, %d projectiles live at the end."),
+		NumProjectiles, SimulateSeconds * 1000.0 / NumSteps, 1.0f / StepTime, Survivors);
+}
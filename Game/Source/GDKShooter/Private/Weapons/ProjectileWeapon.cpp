@@ -4,13 +4,39 @@
 
 #include "Kismet/GameplayStatics.h"
 #include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
 #include "Weapons/Projectile.h"
+#include "Weapons/ProjectilePool.h"
+#include "Weapons/ProjectileSimulation.h"
 #include "GDKLogging.h"
 #include "Components/SkeletalMeshComponent.h"
 
 AProjectileWeapon::AProjectileWeapon()
 {
 	ShotCooldown = 1;
+	NextPredictionId = 0;
+	ProjectilePool = nullptr;
+	ProjectileSimulation = nullptr;
+}
+
+void AProjectileWeapon::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (HasAuthority() && ProjectileBackend == EProjectileBackend::PooledActor)
+	{
+		ProjectilePool = AGDKWorldManager::Get<AProjectilePool>(this);
+		if (ProjectilePool != nullptr)
+		{
+			ProjectilePool->Prewarm(ProjectileClass, ProjectilePoolPrewarmCount);
+		}
+	}
+
+	if (ProjectileBackend == EProjectileBackend::Simulated)
+	{
+		ProjectileSimulation = AGDKWorldManager::Get<AProjectileSimulation>(this);
+	}
 }
 
 void AProjectileWeapon::DoFire_Implementation()
@@ -42,7 +68,7 @@ void AProjectileWeapon::DoFire_Implementation()
 
 	AnnounceShot(false);
 	OnShot();
-	FireProjectile(Barrel, Direction);
+	FireProjectile(Barrel, Direction, PredictProjectile(Barrel, Direction));
 
 	if (!bAllowContinuousFire)
 	{
@@ -54,22 +80,159 @@ void AProjectileWeapon::DoFire_Implementation()
 	}
 }
 
-bool AProjectileWeapon::FireProjectile_Validate(FVector Origin, FVector_NetQuantizeNormal Direction)
+bool AProjectileWeapon::FireProjectile_Validate(FVector Origin, FVector_NetQuantizeNormal Direction, int32 PredictionId)
 {
 	return true;
 }
 
-void AProjectileWeapon::FireProjectile_Implementation(FVector Origin, FVector_NetQuantizeNormal Direction)
+void AProjectileWeapon::FireProjectile_Implementation(FVector Origin, FVector_NetQuantizeNormal Direction, int32 PredictionId)
 {
 	FTransform SpawnTransformMatrix(Direction.Rotation(), Origin);
+	const float CatchUpTime = GetProjectileCatchUpTime();
+
+	if (ProjectileBackend == EProjectileBackend::Simulated && ProjectileSimulation != nullptr)
+	{
+		const int32 ProjectileId = ProjectileSimulation->SpawnProjectile(ProjectileClass, Origin, Direction, this, INDEX_NONE, CatchUpTime);
+		MulticastSimulatedProjectileSpawned(ProjectileId, Origin, Direction, GetServerWorldTimeSeconds() - CatchUpTime, PredictionId);
+		return;
+	}
+
+	if (ProjectileBackend == EProjectileBackend::PooledActor && ProjectilePool != nullptr)
+	{
+		if (AProjectile* Projectile = ProjectilePool->Launch(ProjectileClass, SpawnTransformMatrix, this, MetaData))
+		{
+			Projectile->SetPrediction(this, PredictionId);
+			Projectile->FastForward(CatchUpTime, ProjectileCatchUpStepTime);
+		}
+		return;
+	}
 
 	AProjectile* Projectile = Cast<AProjectile>(UGameplayStatics::BeginDeferredActorSpawnFromClass(this, ProjectileClass, SpawnTransformMatrix));
 	if (Projectile)
 	{
 		Projectile->SetPlayer(this);
 		Projectile->MetaData = MetaData;
+		Projectile->SetPrediction(this, PredictionId);
 		UGameplayStatics::FinishSpawningActor(Projectile, SpawnTransformMatrix);
+		Projectile->FastForward(CatchUpTime, ProjectileCatchUpStepTime);
+	}
+}
+
+float AProjectileWeapon::GetProjectileCatchUpTime() const
+{
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Pawn == nullptr || Pawn->PlayerState == nullptr || Pawn->IsLocallyControlled())
+	{
+		return 0.0f;
+	}
+
+	// ExactPing is the round trip in milliseconds. The shot took half of it to arrive.
+	return FMath::Clamp(Pawn->PlayerState->ExactPing * 0.0005f, 0.0f, MaxProjectileCatchUp);
+}
+
+int32 AProjectileWeapon::PredictProjectile(const FVector& Origin, const FVector& Direction)
+{
+	if (!bPredictProjectiles || HasAuthority() || ProjectileClass == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 PredictionId = NextPredictionId;
+	NextPredictionId = (NextPredictionId + 1) & MAX_int32;
+
+	if (ProjectileBackend == EProjectileBackend::Simulated)
+	{
+		if (ProjectileSimulation == nullptr)
+		{
+			return INDEX_NONE;
+		}
+		PredictedSimulatedProjectiles.Add(PredictionId, ProjectileSimulation->SpawnProjectile(ProjectileClass, Origin, Direction, this, INDEX_NONE, 0.0f));
+		return PredictionId;
+	}
+
+	const FTransform SpawnTransform(Direction.Rotation(), Origin);
+	AProjectile* Projectile = GetWorld()->SpawnActorDeferred<AProjectile>(ProjectileClass, SpawnTransform, this, Instigator, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Projectile == nullptr)
+	{
+		return INDEX_NONE;
+	}
+	Projectile->MakeCosmetic();
+	Projectile->SetPlayer(this);
+	Projectile->FinishSpawning(SpawnTransform);
+
+	// Predictions whose authoritative projectile never arrived have exploded or timed out by now.
+	for (auto It = PredictedProjectiles.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	PredictedProjectiles.Add(PredictionId, Projectile);
+	return PredictionId;
+}
+
+void AProjectileWeapon::ReconcilePredictedProjectile(int32 PredictionId)
+{
+	TWeakObjectPtr<AProjectile> Predicted;
+	if (PredictedProjectiles.RemoveAndCopyValue(PredictionId, Predicted) && Predicted.IsValid())
+	{
+		Predicted->Destroy();
+	}
+
+	int32 SimulatedId;
+	if (PredictedSimulatedProjectiles.RemoveAndCopyValue(PredictionId, SimulatedId) && ProjectileSimulation != nullptr)
+	{
+		FVector Location;
+		ProjectileSimulation->RemoveProjectile(SimulatedId, Location);
+	}
+}
+
+void AProjectileWeapon::MulticastSimulatedProjectileSpawned_Implementation(int32 ProjectileId, FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float SpawnServerTime, int32 PredictionId)
+{
+	// The server already simulates it.
+	if (HasAuthority() || ProjectileSimulation == nullptr)
+	{
+		return;
+	}
+
+	ReconcilePredictedProjectile(PredictionId);
+	ProjectileSimulation->SpawnProjectile(ProjectileClass, Origin, Direction, this, ProjectileId, GetServerWorldTimeSeconds() - SpawnServerTime);
+}
+
+void AProjectileWeapon::MulticastSimulatedProjectileExploded_Implementation(int32 ProjectileId, FVector_NetQuantize Location)
+{
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	if (ProjectileSimulation != nullptr && !HasAuthority())
+	{
+		FVector SimulatedLocation;
+		ProjectileSimulation->RemoveProjectile(ProjectileId, SimulatedLocation);
+	}
+	PlaySimulatedExplosion(Location);
+	OnSimulatedProjectileExploded(Location);
+}
+
+void AProjectileWeapon::PlaySimulatedExplosion(const FVector& Location)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return;
+	}
+
+	// The projectile class's own visuals play the explosion, so classes need no extra work to be simulated.
+	const FTransform SpawnTransform(Location);
+	AProjectile* Explosion = GetWorld()->SpawnActorDeferred<AProjectile>(ProjectileClass, SpawnTransform, this, Instigator, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Explosion == nullptr)
+	{
+		return;
 	}
+	Explosion->MakeCosmeticExplosion();
+	Explosion->SetPlayer(this);
+	Explosion->FinishSpawning(SpawnTransform);
 }
 
 void AProjectileWeapon::ConsumeBufferedShot()
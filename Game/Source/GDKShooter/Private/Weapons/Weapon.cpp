@@ -5,17 +5,35 @@
 #include "Engine/World.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "CollisionQueryParams.h"
+#include "GameFramework/ComponentRegistry.h"
+#include "GameFramework/GameStateBase.h"
 #include "Kismet/GameplayStatics.h"
 #include "GDKLogging.h"
 #include "UnrealNetwork.h"
+#include "Weapons/WeaponFiringScheduler.h"
 
 
 AWeapon::AWeapon()
 {
+	// Firing is driven by AWeaponFiringScheduler while the weapon is in use, so only Blueprints with an Event Tick tick.
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 	PrimaryActorTick.TickGroup = TG_PrePhysics;
 
 	BufferShotThreshold = 0.2f;
+	bTicksInBlueprint = false;
+	FiringScheduler = nullptr;
+}
+
+void AWeapon::BeginPlay()
+{
+	Super::BeginPlay();
+
+	bTicksInBlueprint = GetClass()->IsFunctionImplementedInBlueprint(GET_FUNCTION_NAME_CHECKED(AActor, ReceiveTick));
+	if (bTicksInBlueprint)
+	{
+		SetActorTickEnabled(true);
+	}
 }
 
 void AWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -54,6 +72,15 @@ void AWeapon::StartPrimaryUse_Implementation()
 	bHasBufferedShot = true;
 	BufferedShotUntil = UGameplayStatics::GetRealTimeSeconds(GetWorld()) + BufferShotThreshold;
 
+	if (FiringScheduler == nullptr)
+	{
+		FiringScheduler = AGDKWorldManager::Get<AWeaponFiringScheduler>(this);
+	}
+	if (FiringScheduler != nullptr)
+	{
+		FiringScheduler->Schedule(this);
+	}
+
 	if (GetMovementComponent())
 	{
 		GetMovementComponent()->SetIsBusy(true);
@@ -123,10 +150,8 @@ void AWeapon::ConsumeBufferedShot()
 	bHasBufferedShot = false;
 }
 
-void AWeapon::Tick(float DeltaTime)
+bool AWeapon::UpdateFiring()
 {
-	Super::Tick(DeltaTime);
-
 	if ((IsPrimaryUsing || HasBufferedShot()) && ReadyToFire())
 	{
 		ConsumeBufferedShot();
@@ -152,6 +177,8 @@ void AWeapon::Tick(float DeltaTime)
 			}
 		}
 	}
+
+	return IsPrimaryUsing || HasBufferedShot();
 }
 
 void AWeapon::SetIsActive(bool bNewIsActive)
@@ -171,8 +198,8 @@ void AWeapon::RefreshComponentCache()
 	}
 	else
 	{
-		CachedMovementComponent = Cast<UGDKMovementComponent>(CachedOwner->GetComponentByClass(UGDKMovementComponent::StaticClass()));
-		CachedShootingComponent = Cast<UShootingComponent>(CachedOwner->GetComponentByClass(UShootingComponent::StaticClass()));
+		CachedMovementComponent = FComponentRegistry::Get<UGDKMovementComponent>(CachedOwner);
+		CachedShootingComponent = FComponentRegistry::Get<UShootingComponent>(CachedOwner);
 	}
 }
 
@@ -204,5 +231,16 @@ FInstantHitInfo AWeapon::DoLineTrace()
 		return HitInfo;
 	}
 
-	return GetShootingComponent()->DoLineTrace(GetLineTraceDirection(), this);
+	FInstantHitInfo HitInfo = GetShootingComponent()->DoLineTrace(GetLineTraceDirection(), this);
+	HitInfo.FireTime = GetServerWorldTimeSeconds();
+	return HitInfo;
+}
+
+float AWeapon::GetServerWorldTimeSeconds() const
+{
+	if (AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		return GameState->GetServerWorldTimeSeconds();
+	}
+	return GetWorld()->GetTimeSeconds();
 }
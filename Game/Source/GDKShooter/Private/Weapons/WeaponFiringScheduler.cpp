@@ -0,0 +1,49 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "WeaponFiringScheduler.h"
+
+#include "GDKStats.h"
+#include "Weapons/Weapon.h"
+
+DECLARE_CYCLE_STAT(TEXT("WeaponFiringScheduler"), STAT_GDKWeaponFiringScheduler, STATGROUP_GDKShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ScheduledWeapons"), STAT_GDKScheduledWeapons, STATGROUP_GDKShooter);
+
+AWeaponFiringScheduler::AWeaponFiringScheduler()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+void AWeaponFiringScheduler::Schedule(AWeapon* Weapon)
+{
+	ScheduledWeapons.AddUnique(Weapon);
+	SetActorTickEnabled(true);
+}
+
+void AWeaponFiringScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_GDKWeaponFiringScheduler);
+	INC_DWORD_STAT_BY(STAT_GDKScheduledWeapons, ScheduledWeapons.Num());
+
+	// Weapons can schedule others while firing, which are appended and updated this frame.
+	for (int32 Index = 0; Index < ScheduledWeapons.Num();)
+	{
+		AWeapon* Weapon = ScheduledWeapons[Index].Get();
+		if (Weapon != nullptr && Weapon->UpdateFiring())
+		{
+			++Index;
+		}
+		else
+		{
+			ScheduledWeapons.RemoveAtSwap(Index);
+		}
+	}
+
+	if (ScheduledWeapons.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
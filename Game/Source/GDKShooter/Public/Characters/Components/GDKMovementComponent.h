@@ -9,6 +9,17 @@
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FAimingUpdated, bool, bIsAiming);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSprintingUpdated, bool, bIsSprinting);
 
+class AServerMoveScheduler;
+
+// The state that decides the character's max speed and acceleration, in order of precedence.
+enum class EGDKSpeedMode : uint8
+{
+	Crouching,
+	Aiming,
+	Sprinting,
+	Jogging,
+};
+
 UCLASS()
 class GDKSHOOTER_API UGDKMovementComponent : public UCharacterMovementComponent
 {
@@ -21,6 +32,7 @@ public:
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	friend class FSavedMove_GDKMovement;
+	friend class AServerMoveScheduler;
 
 	UGDKMovementComponent(const FObjectInitializer& ObjectInitializer);
 
@@ -28,6 +40,15 @@ public:
 
 	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
 
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+
+	virtual void SimulateMovement(float DeltaTime) override;
+
+	virtual void ServerMove_Implementation(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags,
+		uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+
+	virtual void ServerMoveOld_Implementation(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags) override;
+
 	// Sets whether the character is trying to sprint.
 	void SetWantsToSprint(bool bSprinting);
 
@@ -39,9 +60,7 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Sprint")
 		void SetSprintEnabled(bool bSprintEnabled);
 	
-	// Set if the character should be aiming
-	UFUNCTION(BlueprintCallable, Server, Reliable, WithValidation)
-		void ServerSetAiming(bool NewValue);
+	// Set if the character should be aiming. Sent to the server with the character's moves.
 	UFUNCTION(BlueprintCallable)
 		void SetAiming(bool NewValue);
 
@@ -69,6 +88,13 @@ public:
 	// True if movement direction is within SprintDirectionTolerance of the look direction.
 	UFUNCTION(BlueprintPure)
 		bool IsMovingForward() const;
+
+	// Returns the speed mode for the current move step. The direction check is done once per step, and the mode is
+	// only worked out again when the crouch, aim, busy or sprint state changes.
+	EGDKSpeedMode GetSpeedMode() const;
+
+	// Console command: compares the speed queries of a move step with and without the cached speed mode.
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
 	
 		// Multiply max speed by this factor when sprinting.
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Character Movement: Walking")
@@ -101,6 +127,7 @@ private:
 	uint8 bWasSprintingLastFrame : 1;
 
 	// If true, the player is aiming, should therefore move slower, and should not be allowed to sprint.
+	// Only replicated to simulated proxies, as the owner predicts it.
 	UPROPERTY(VisibleAnywhere, ReplicatedUsing = OnRep_IsAiming)
 		bool bIsAiming;
 
@@ -132,6 +159,54 @@ private:
 	// Multiply acceleration by this factor when aiming.
 	UPROPERTY(EditAnywhere, Category = "Character Movement (General Settings)")
 		float JogAcceleration;
+
+	// Works out the speed mode from the state packed in Key.
+	static EGDKSpeedMode ComputeSpeedMode(uint8 Key);
+
+	// Packs the state the speed mode depends on, with the direction check as of the start of the move step.
+	uint8 GetSpeedModeKey(bool bMovingForward) const;
+
+	// A client move received by the server, waiting for the server move scheduler.
+	struct FQueuedServerMove
+	{
+		// True for a ServerMoveOld, which only has a time stamp, acceleration and flags.
+		bool bOldMove;
+		float TimeStamp;
+		FVector_NetQuantize10 Accel;
+		FVector_NetQuantize100 ClientLoc;
+		uint8 CompressedMoveFlags;
+		uint8 ClientRoll;
+		uint32 View;
+		TWeakObjectPtr<UPrimitiveComponent> ClientMovementBase;
+		FName ClientBaseBoneName;
+		uint8 ClientMovementMode;
+	};
+
+	// [server] Returns a new entry in the move queue, or nullptr if the move should be processed now.
+	FQueuedServerMove* QueueServerMove();
+
+	// [server] Processes the queued moves in the order they arrived, and returns how many there were.
+	int32 ProcessQueuedServerMoves();
+
+	// [server] If true, client moves are queued as they arrive and processed with every other character's moves in one
+	// pass per frame, rather than one at a time.
+	UPROPERTY(EditAnywhere, Category = "Character Movement (Networking)")
+		bool bBatchServerMoves;
+
+	uint8 bProcessingQueuedServerMoves : 1;
+
+	TArray<FQueuedServerMove> QueuedServerMoves;
+
+	UPROPERTY()
+		AServerMoveScheduler* ServerMoveScheduler;
+
+	// Result of IsMovingForward at the start of the current move step.
+	uint8 bMovingForwardThisMove : 1;
+
+	// Key that CachedSpeedMode was worked out from, or an invalid key if it hasn't been yet.
+	mutable uint8 CachedSpeedModeKey;
+
+	mutable EGDKSpeedMode CachedSpeedMode;
 };
 
 class FSavedMove_GDKMovement : public FSavedMove_Character
@@ -149,6 +224,7 @@ public:
 
 private:
 	uint8 bSavedWantsToSprint : 1;
+	uint8 bSavedIsAiming : 1;
 };
 
 class FNetworkPredictionData_Client_GDKMovement : public FNetworkPredictionData_Client_Character
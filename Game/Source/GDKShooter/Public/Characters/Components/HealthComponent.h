@@ -6,8 +6,8 @@
 #include "Components/ActorComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
 #include "Runtime/AIModule/Classes/GenericTeamAgentInterface.h"
-#include "TimerManager.h"
 #include "HealthComponent.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FFloatValue, float, Current, float, Max);
@@ -15,11 +15,60 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_FiveParams(FDamageTakenEvent, float, Value, F
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDeathCauserEvent, const AController*, Instigator);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FDeathEvent);
 
+class ARegenerationScheduler;
+
+// Damage taken from one direction within a frame.
+USTRUCT()
+struct FDamageSource
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		float Damage;
+
+	UPROPERTY()
+		FVector_NetQuantize Source;
+
+	// Impact point of the latest hit from this direction.
+	UPROPERTY()
+		FVector_NetQuantize Impact;
+
+	FDamageSource() :
+		Damage(0.0f),
+		Source(ForceInitToZero),
+		Impact(ForceInitToZero)
+	{}
+};
+
+// All the damage taken in one server frame, with hits from similar directions merged.
+USTRUCT()
+struct FDamageSummary
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		TArray<FDamageSource> Sources;
+
+	// Player and team that dealt the largest single hit.
+	UPROPERTY()
+		int32 InstigatorPlayerId;
+
+	UPROPERTY()
+		FGenericTeamId InstigatorTeamId;
+
+	FDamageSummary() :
+		InstigatorPlayerId(-1),
+		InstigatorTeamId(FGenericTeamId::NoTeam)
+	{}
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class GDKSHOOTER_API UHealthComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
+	friend class ARegenerationScheduler;
+
 public:	
 	UHealthComponent();
 
@@ -27,6 +76,9 @@ public:
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	// [server] Sends the damage taken this frame, then stops ticking until more damage is taken.
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	UFUNCTION(BlueprintCallable)
@@ -75,9 +127,22 @@ public:
 
 protected:
 
-	// Notifies all clients that a the character has been hit and from what direction.
+	// Notifies clients the owner is relevant to of the damage it took in a frame, and from what directions.
 	UFUNCTION(NetMulticast, Unreliable)
-		void MulticastDamageTaken(float Value, FVector Source, FVector Impact, int32 PlayerId, FGenericTeamId TeamId);
+		void MulticastDamageTaken(const FDamageSummary& Summary);
+
+	// [server] Adds a hit to the damage taken this frame.
+	void AccumulateDamage(float Damage, const FVector& Source, const FVector& Impact, int32 InstigatorPlayerId, FGenericTeamId InstigatorTeamId);
+
+	// Maximum number of directions sent per frame. Further hits are merged into the closest direction.
+	UPROPERTY(EditDefaultsOnly, Category = "Health", meta = (ClampMin = "1"))
+		int32 MaxDamageSources;
+
+	// [server] Damage taken this frame, not yet sent.
+	FDamageSummary PendingDamage;
+
+	// [server] Largest single hit this frame.
+	float LargestPendingHit;
 
 	UFUNCTION()
 		void OnRep_CurrentHealth();
@@ -101,7 +166,12 @@ protected:
 	UPROPERTY(VisibleAnywhere, ReplicatedUsing = OnRep_CurrentArmour, Category = "Health")
 		float CurrentArmour;
 
-	FTimerHandle HealthRegenerationHandle;
+	// [server] Scheduler that regenerates the component after it takes damage.
+	UPROPERTY()
+		ARegenerationScheduler* RegenerationScheduler;
+
+	// Index of the component's entry in the regeneration scheduler, or INDEX_NONE if it isn't regenerating.
+	int32 RegenerationIndex;
 
 	UFUNCTION()
 		void RegenerateHealth();
@@ -115,8 +185,6 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		float HealthRegenInterval;
 
-	FTimerHandle ArmourRegenerationHandle;
-
 	UFUNCTION()
 		void RegenerateArmour();
 
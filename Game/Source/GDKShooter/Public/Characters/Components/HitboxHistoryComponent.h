@@ -0,0 +1,111 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "HitboxHistoryComponent.generated.h"
+
+class UGDKMovementComponent;
+class UShootingComponent;
+
+// The owner's hitbox at a point in server time.
+struct FHitboxSnapshot
+{
+	float Timestamp;
+	FVector Center;
+	FVector Extent;
+};
+
+// Where the owner was shooting from and aiming at a point in server time, as the server had received it from the owning client.
+struct FViewSnapshot
+{
+	float Timestamp;
+	FVector ViewLocation;
+	FRotator AimRotation;
+	bool bAiming;
+	bool bCrouching;
+};
+
+/**
+ * UHitboxHistoryComponent keeps a fixed-size ring of hitbox snapshots of its owner on the server, so that
+ * hits can be validated against where the target was when the client fired rather than where it is now.
+ * If the owner can shoot, its view is recorded alongside, so that shots can be validated against where it was aiming.
+ * Snapshots are taken on a fixed time grid, so finding the snapshots around a given time is O(1),
+ * and the ring is allocated once when recording starts.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class GDKSHOOTER_API UHitboxHistoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UHitboxHistoryComponent();
+
+	virtual void BeginPlay() override;
+
+	// [server] Starts recording when this server gains authority over the owner, for example after it migrates.
+	void OnAuthorityGained();
+
+	// [server] Stops recording and drops the history when another server takes over the owner.
+	void OnAuthorityLost();
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+
+	// [server] Gets the owner's hitbox at the given server time, interpolated between the two nearest snapshots.
+	// Times before the start of the history are clamped to the oldest snapshot, times after it to the newest.
+	// Returns false if no history has been recorded yet.
+	bool GetHitboxAtTime(float Time, FBox& OutHitbox) const;
+
+	// [server] Gets the owner's views from the given server time on, oldest first: the view at Time, interpolated
+	// between the two nearest snapshots, followed by every newer snapshot.
+	// Returns false if the owner's view is not recorded, or no history has been recorded yet.
+	bool GetViewsSince(float Time, TArray<FViewSnapshot>& OutViews) const;
+
+	// How far back in time, in seconds, the history reaches.
+	float GetMaxRewindTime() const { return MaxRewindTime; }
+
+protected:
+
+	// How far back in time, in seconds, hits can be rewound.
+	UPROPERTY(EditDefaultsOnly, Category = "Hit Validation", meta = (ClampMin = "0"))
+		float MaxRewindTime;
+
+	// Time between snapshots, in seconds.
+	UPROPERTY(EditDefaultsOnly, Category = "Hit Validation", meta = (ClampMin = "0.001"))
+		float SnapshotInterval;
+
+private:
+
+	// Allocates the ring and starts ticking from the current time.
+	void StartRecording();
+
+	void RecordSnapshot(float Timestamp, const FBox& Hitbox, const FViewSnapshot& View);
+
+	// The owner's current view, if it can shoot.
+	bool GetCurrentView(FViewSnapshot& OutView) const;
+
+	// Finds the snapshots to blend for the given time: OutAlpha of the way from the one OutNewerSteps before the newest,
+	// to the one OutOlderSteps before it.
+	void FindSnapshotsAtTime(float Time, int32& OutNewerSteps, int32& OutOlderSteps, float& OutAlpha) const;
+
+	TArray<FHitboxSnapshot> Snapshots;
+
+	// Views recorded with the hitbox snapshots at the same indices. Empty if the owner can't shoot.
+	TArray<FViewSnapshot> Views;
+
+	UPROPERTY()
+		UShootingComponent* ShootingComponent;
+
+	UPROPERTY()
+		UGDKMovementComponent* MovementComponent;
+
+	// Index of the most recent snapshot in the ring.
+	int32 NewestIndex;
+
+	// Number of valid snapshots in the ring.
+	int32 NumSnapshots;
+
+	// Server time at which the next snapshot is due.
+	float NextSnapshotTime;
+};
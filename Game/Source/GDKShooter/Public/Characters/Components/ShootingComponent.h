@@ -4,11 +4,26 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "WorldCollision.h"
 #include "Weapons/ITraceProvider.h"
 #include "ShootingComponent.generated.h"
 
+class AHitscanManager;
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FShotEvent, AWeapon*, Weapon, bool, Hit);
 
+UENUM(BlueprintType)
+enum class EShootingTraceMode : uint8
+{
+	// Trace the physics scene, against complex collision.
+	Complex			UMETA(DisplayName = "Complex"),
+	// Trace simplified character hitboxes, with static geometry from the physics scene as occluders.
+	HitscanProxies	UMETA(DisplayName = "Hitscan Proxies"),
+	// Trace the physics scene against simple collision, then refine with complex collision on the candidate actor only.
+	TwoPhase		UMETA(DisplayName = "Two Phase"),
+};
+
 USTRUCT(BlueprintType)
 struct FInstantHitInfo
 {
@@ -25,13 +40,39 @@ struct FInstantHitInfo
 	UPROPERTY(BlueprintReadOnly)
 		bool bDidHit;
 
+	// Server time at which the shot was fired, as estimated by the shooter. Used to rewind the hit actor when validating.
+	UPROPERTY(BlueprintReadOnly)
+		float FireTime;
+
+	// Index of the shot in the weapon's deterministic spread sequence, or INDEX_NONE if the shot has no spread index.
+	UPROPERTY(BlueprintReadOnly)
+		int32 ShotIndex;
+
 	FInstantHitInfo() :
 		Location(FVector{ 0,0,0 }),
 		HitActor(nullptr),
-		bDidHit(false)
+		bDidHit(false),
+		FireTime(0.0f),
+		ShotIndex(INDEX_NONE)
 	{}
+
+	// Compact wire format: hit and actor flags in bits, the location quantized to 0.1 units, the shot index packed,
+	// and no actor reference for misses. The fire time stays a full float. Fails if the location is out of the quantized range.
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
 };
 
+template<>
+struct TStructOpsTypeTraits<FInstantHitInfo> : public TStructOpsTypeTraitsBase2<FInstantHitInfo>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+// Results of a batch of line traces, in the order the directions were given.
+DECLARE_DELEGATE_OneParam(FLineTraceBatchComplete, const TArray<FInstantHitInfo>&);
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class GDKSHOOTER_API UShootingComponent : public UActorComponent
 {
@@ -64,6 +105,13 @@ public:
 
 	UFUNCTION(BlueprintPure)
 		FInstantHitInfo DoLineTrace(FVector Direction, AActor* ActorToIgnore = nullptr);
+
+	// Submits one line trace per direction with the async trace API. OnComplete is called with all results once the
+	// last trace is done, usually next frame. Trace modes that async traces can't express are traced immediately instead.
+	void AsyncLineTraceBatch(const TArray<FVector>& Directions, AActor* ActorToIgnore, const FLineTraceBatchComplete& OnComplete);
+
+	// Maximum number of directions in a single async batch.
+	static const int32 MaxAsyncBatchSize = 256;
 	
 protected:
 
@@ -78,4 +126,37 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Shooting")
 		TEnumAsByte<ECollisionChannel> TraceChannel = ECC_WorldStatic;
 
+	// How shots are traced against the world.
+	UPROPERTY(EditAnywhere, Category = "Shooting")
+		EShootingTraceMode TraceMode = EShootingTraceMode::Complex;
+
+private:
+
+	struct FAsyncTraceBatch
+	{
+		TArray<FInstantHitInfo> Results;
+		int32 NumRemaining;
+		FLineTraceBatchComplete OnComplete;
+	};
+
+	FCollisionQueryParams MakeTraceParams(AActor* ActorToIgnore) const;
+
+	static FInstantHitInfo MakeHitInfo(bool bDidHit, const FHitResult& HitResult, const FVector& TraceEnd);
+
+	void OnAsyncTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData);
+
+	// Simple-collision trace for candidates, refined against each candidate's complex collision.
+	// Falls back to a single complex trace of the rest of the ray if there are more than MaxTwoPhaseCandidates candidates.
+	bool TwoPhaseLineTrace(FHitResult& OutHit, const FVector& TraceStart, const FVector& TraceEnd, const FCollisionQueryParams& TraceParams) const;
+
+	UPROPERTY()
+		AHitscanManager* HitscanManager;
+
+	// Async batches in flight, by batch id.
+	TMap<uint32, FAsyncTraceBatch> AsyncTraceBatches;
+
+	uint32 NextAsyncBatchId;
+
+	FTraceDelegate AsyncTraceDelegate;
+
 };
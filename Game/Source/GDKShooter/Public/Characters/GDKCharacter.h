@@ -6,12 +6,14 @@
 #include "Materials/MaterialInstance.h"
 #include "GameFramework/Character.h"
 #include "Components/HealthComponent.h"
+#include "Components/HitboxHistoryComponent.h"
 #include "Components/EquippedComponent.h"
 #include "Components/MetaDataComponent.h"
 #include "Components/GDKMovementComponent.h"
 #include "Components/TeamComponent.h"
 #include "Weapons/Holdable.h"
-#include "TimerManager.h"
+#include "GameFramework/CrossServerDamage.h"
+#include "GameFramework/TimerWheel.h"
 #include "Runtime/AIModule/Classes/GenericTeamAgentInterface.h"
 #include "Runtime/AIModule/Classes/Perception/AISightTargetInterface.h"
 #include "GDKCharacter.generated.h"
@@ -31,6 +33,9 @@ public:
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void OnAuthorityGained() override;
+	virtual void OnAuthorityLost() override;
 
 	UPROPERTY(Category = Character, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 		UHealthComponent* HealthComponent;
@@ -47,6 +52,9 @@ protected:
 	UPROPERTY(Category = Character, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 		UTeamComponent* TeamComponent;
 
+	UPROPERTY(Category = Character, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+		UHitboxHistoryComponent* HitboxHistoryComponent;
+
 	UFUNCTION(BlueprintPure)
 		float GetRemotePitch() {
 			return RemoteViewPitch;
@@ -83,13 +91,19 @@ private:
 	UFUNCTION()
 		void DeleteSelf();
 
-	FTimerHandle DeletionTimer;
-	FTimerDelegate DeletionDelegate;
+	FTimerWheelHandle DeletionTimer;
+
+	UPROPERTY()
+		ACrossServerDamageQueue* DamageQueue;
+
+	// [server] Applies damage on the server with authority over this character, whether dealt here or on another server.
+	void ApplyDamage(float Damage, const struct FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
 	
 public:
 
 	float TakeDamage(float Damage, const struct FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
+	// Applies the damage queued for this character during a frame on another server.
 	UFUNCTION(CrossServer, Reliable)
-		void TakeDamageCrossServer(float Damage, const struct FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
+		void TakeDamageCrossServer(const TArray<FCrossServerDamage>& Hits);
 };
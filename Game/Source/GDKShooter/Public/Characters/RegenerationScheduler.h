@@ -0,0 +1,53 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "RegenerationScheduler.generated.h"
+
+class UHealthComponent;
+
+/**
+ * ARegenerationScheduler regenerates the health and armour of damaged health components, in place of a pair of
+ * timer manager timers per component. Each regenerating component has an entry holding the times its next health
+ * and armour regeneration is due. Taking damage just pushes those times back, and all due entries are processed
+ * in one pass at a fixed rate.
+ * Components are added when they take damage and dropped once regeneration has nothing left to do.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API ARegenerationScheduler : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	ARegenerationScheduler();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// [server] Restarts the component's regeneration cooldowns, adding it to the scheduler if needed.
+	void DelayRegeneration(UHealthComponent* Component);
+
+	void Unregister(UHealthComponent* Component);
+
+	// Console command: compares re-arming regeneration timers on the timer manager with updating scheduler entries,
+	// for N damaged components.
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	struct FRegenerationEntry
+	{
+		TWeakObjectPtr<UHealthComponent> Component;
+		// World time the next regeneration is due, or MAX_flt if the component doesn't regenerate.
+		float NextHealthTime;
+		float NextArmourTime;
+	};
+
+	void RemoveAt(int32 Index);
+
+	// Time between passes over the entries, in seconds.
+	static const float UpdateInterval;
+
+	TArray<FRegenerationEntry> Entries;
+};
@@ -0,0 +1,50 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "ServerMoveScheduler.generated.h"
+
+class UGDKMovementComponent;
+
+/**
+ * AServerMoveScheduler processes the client moves queued by movement components with bBatchServerMoves set, for all
+ * characters in one pass at the start of the frame. Characters are visited in order of their location along a
+ * Z-order curve, so consecutive moves sweep through the same part of the physics scene, and each character's moves
+ * are processed back to back.
+ * Moves run one after another on the game thread, since a move sweeps and then moves components in the scene.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API AServerMoveScheduler : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	AServerMoveScheduler();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// [server] Adds a movement component with moves waiting to the next pass.
+	void Enqueue(UGDKMovementComponent* Movement);
+
+	// Console command: logs the moves processed since the last call, and how many moves per second one core can process.
+	static void LogThroughput(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	struct FScheduledMovement
+	{
+		uint32 SortKey;
+		UGDKMovementComponent* Movement;
+	};
+
+	TArray<TWeakObjectPtr<UGDKMovementComponent>> Pending;
+
+	TArray<FScheduledMovement> Scheduled;
+
+	// Totals since the throughput was last logged.
+	int64 NumMovesProcessed;
+	double ProcessingSeconds;
+	double ThroughputStartTime;
+};
@@ -0,0 +1,13 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+// Stats for the GDKShooter gameplay systems, viewable in game with "stat GDKShooter".
+DECLARE_STATS_GROUP(TEXT("GDKShooter"), STATGROUP_GDKShooter, STATCAT_Advanced);
+
+// Hits applied directly by the server with authority over the victim, and hits sent to the victim's server in an RPC.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("LocalDamageHits"), STAT_GDKLocalDamageHits, STATGROUP_GDKShooter, GDKSHOOTER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("CrossServerDamageHits"), STAT_GDKCrossServerDamageHits, STATGROUP_GDKShooter, GDKSHOOTER_API);
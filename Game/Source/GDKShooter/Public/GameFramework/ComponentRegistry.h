@@ -0,0 +1,55 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GameFramework/Actor.h"
+
+/**
+ * FComponentRegistry caches the result of looking up an actor's component by class, as a cheaper alternative to
+ * GetComponentByClass on hot paths. Each actor's cache is filled the first time a class is looked up, and is
+ * dropped whenever a component is added to or removed from the actor. Cached components that are unregistered or
+ * destroyed are looked up again.
+ * Only use it from the game thread.
+ */
+class GDKSHOOTER_API FComponentRegistry
+{
+public:
+
+	// Returns the actor's first component of class T, as GetComponentByClass would, or nullptr.
+	template<class T>
+	static T* Get(const AActor* Actor)
+	{
+		return static_cast<T*>(Get(Actor, T::StaticClass()));
+	}
+
+	static UActorComponent* Get(const AActor* Actor, UClass* ComponentClass);
+
+	// Console command: compares the component lookups of a damage event through GetComponentByClass and the registry.
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	struct FCachedComponent
+	{
+		UClass* ComponentClass;
+		TWeakObjectPtr<UActorComponent> Component;
+		// False if the actor has no component of the class.
+		bool bFound;
+	};
+
+	struct FActorComponents
+	{
+		TArray<FCachedComponent, TInlineAllocator<8>> Components;
+		// Number of components the actor owned when the cache was filled. Adding or removing one changes it.
+		int32 NumOwnedComponents;
+	};
+
+	// Drops the caches of destroyed actors.
+	static void Prune();
+
+	static TMap<TWeakObjectPtr<const AActor>, FActorComponents> Actors;
+
+	static int32 NumActorsAtLastPrune;
+};
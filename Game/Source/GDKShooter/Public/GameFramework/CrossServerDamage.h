@@ -0,0 +1,130 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Engine/NetSerialization.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "Templates/Function.h"
+#include "CrossServerDamage.generated.h"
+
+class AController;
+
+UENUM()
+enum class ECrossServerDamageType : uint8
+{
+	Generic,
+	Point,
+	Radial,
+};
+
+/**
+ * A damage event as sent between servers. FDamageEvent is polymorphic, so passing it to an RPC slices off the point
+ * and radial data. This carries what the receiving server needs from each kind explicitly, quantized.
+ * Radial falloff is resolved by the sending server, which found the victim, so Damage is always the final amount.
+ */
+USTRUCT()
+struct FCrossServerDamage
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		float Damage;
+
+	UPROPERTY()
+		ECrossServerDamageType Type;
+
+	UPROPERTY()
+		TSubclassOf<UDamageType> DamageTypeClass;
+
+	// Point: the impact point. Radial: the point on the victim closest to the origin.
+	UPROPERTY()
+		FVector Impact;
+
+	// Point only.
+	UPROPERTY()
+		FVector ShotDirection;
+
+	// Radial only.
+	UPROPERTY()
+		FVector Origin;
+
+	// Radial only: the outer radius of the explosion.
+	UPROPERTY()
+		float Radius;
+
+	UPROPERTY()
+		AController* EventInstigator;
+
+	UPROPERTY()
+		AActor* DamageCauser;
+
+	FCrossServerDamage() :
+		Damage(0.0f),
+		Type(ECrossServerDamageType::Generic),
+		Impact(ForceInitToZero),
+		ShotDirection(ForceInitToZero),
+		Origin(ForceInitToZero),
+		Radius(0.0f),
+		EventInstigator(nullptr),
+		DamageCauser(nullptr)
+	{}
+
+	FCrossServerDamage(float InDamage, const struct FDamageEvent& DamageEvent, AController* InEventInstigator, AActor* InDamageCauser);
+
+	// Adds Other to this if the receiving server would treat them the same, keeping the latest impact.
+	bool TryMerge(const FCrossServerDamage& Other);
+
+	// Rebuilds the damage event for Victim and passes it to Receiver, which must not keep it.
+	void Dispatch(AActor* Victim, TFunctionRef<void(float Damage, const struct FDamageEvent& DamageEvent)> Receiver) const;
+
+	// Compact wire format: the type and which references are set in bits, vectors quantized, the radius rounded,
+	// and only the fields of the damage type.
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCrossServerDamage> : public TStructOpsTypeTraitsBase2<FCrossServerDamage>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+// Sends a victim's damage for a frame to the server with authority over it.
+DECLARE_DELEGATE_OneParam(FSendCrossServerDamage, const TArray<FCrossServerDamage>&);
+
+/**
+ * ACrossServerDamageQueue collects the damage dealt to each victim during a frame and sends it in one RPC at the
+ * end of the frame, instead of one reliable RPC per hit. Hits from the same instigator and causer are merged.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API ACrossServerDamageQueue : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	ACrossServerDamageQueue();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// [server] Queues damage to Victim. Send is called with all of the victim's damage at the end of the frame.
+	void Add(AActor* Victim, const FCrossServerDamage& Hit, const FSendCrossServerDamage& Send);
+
+private:
+
+	struct FPendingDamage
+	{
+		TWeakObjectPtr<AActor> Victim;
+		FSendCrossServerDamage Send;
+		TArray<FCrossServerDamage> Hits;
+	};
+
+	TArray<FPendingDamage> Pending;
+
+	// Index in Pending of each victim.
+	TMap<TWeakObjectPtr<AActor>, int32> PendingIndices;
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
+#include "GameFramework/CrossServerDamage.h"
 #include "CrossServerPawn.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FIncomingDamageEvent, float, Damage, const struct FDamageEvent&, DamageEvent, AController*, EventInstigator, AActor*, DamageCauser);
@@ -14,12 +15,24 @@ class GDKSHOOTER_API ACrossServerPawn : public APawn
 	GENERATED_BODY()
 
 public:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UPROPERTY(BlueprintAssignable)
 		FIncomingDamageEvent IncomingDamage;
 
 	float TakeDamage(float Damage, const struct FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
+	// Applies the damage queued for this pawn during a frame on another server.
 	UFUNCTION(CrossServer, Reliable)
-		void TakeDamageCrossServer(float Damage, const struct FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
+		void TakeDamageCrossServer(const TArray<FCrossServerDamage>& Hits);
+
+private:
+
+	// [server] Applies damage on the server with authority over this pawn.
+	void ApplyDamage(float Damage, const struct FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
+
+	UPROPERTY()
+		ACrossServerDamageQueue* DamageQueue;
 	
 };
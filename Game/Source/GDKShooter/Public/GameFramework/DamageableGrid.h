@@ -0,0 +1,98 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "Engine/EngineTypes.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "DamageableGrid.generated.h"
+
+class AController;
+
+/**
+ * ADamageableGrid keeps damageable actors in a uniform grid of cells on the horizontal plane, so radial damage and
+ * proximity queries only look at actors near the origin instead of overlapping the physics scene.
+ * Actors register themselves, and are moved between cells when their root component moves.
+ * Radial damage gathers candidates from the grid, runs all their visibility traces in one pass, and then applies damage.
+ * The falloff is measured to the point of the victim's root bounding box closest to the origin.
+ * Damageable actors that don't register are found by overlapping the physics scene, unless bDamageUnregisteredActors is off.
+ */
+UCLASS()
+class GDKSHOOTER_API ADamageableGrid : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	ADamageableGrid();
+
+	void Register(AActor* Actor);
+	void Unregister(AActor* Actor);
+
+	// Adds registered actors whose root bounds are within Radius of Origin to OutActors.
+	void GatherActorsInRadius(const FVector& Origin, float Radius, TArray<AActor*>& OutActors) const;
+
+	// Damages registered actors within DamageOuterRadius of Origin that aren't hidden behind geometry on
+	// DamagePreventionChannel. Returns true if any actor was damaged.
+	bool ApplyRadialDamageWithFalloff(float BaseDamage, float MinimumDamage, const FVector& Origin, float DamageInnerRadius, float DamageOuterRadius,
+		float DamageFalloff, TSubclassOf<UDamageType> DamageTypeClass, const TArray<AActor*>& IgnoreActors, AActor* DamageCauser,
+		AController* InstigatedByController, ECollisionChannel DamagePreventionChannel = ECC_Visibility);
+
+	// Console command: compares the cost of finding an explosion's victims through the grid and through the physics scene,
+	// for crowds of each given size.
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	struct FDamageableEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<USceneComponent> Root;
+		FIntPoint Cell;
+		FDelegateHandle TransformUpdatedHandle;
+	};
+
+	// An actor in range of an explosion, with the point on its bounds closest to the origin.
+	struct FDamageableCandidate
+	{
+		AActor* Actor;
+		USceneComponent* Root;
+		FVector ClosestPoint;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	void AddToCell(const FIntPoint& Cell, int32 EntryIndex);
+	void RemoveFromCell(const FIntPoint& Cell, int32 EntryIndex);
+
+	void OnTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	// Finds registered, damageable actors within Radius of Origin.
+	void GatherCandidates(const FVector& Origin, float Radius, const TArray<AActor*>& IgnoreActors, TArray<FDamageableCandidate>& OutCandidates) const;
+
+	// Adds damageable actors within Radius of Origin that aren't registered, found by overlapping dynamic objects.
+	void GatherUnregisteredCandidates(const FVector& Origin, float Radius, const TArray<AActor*>& IgnoreActors, TArray<FDamageableCandidate>& InOutCandidates) const;
+
+	// Removes the candidates whose centre is hidden from Origin on TraceChannel, in one pass of traces.
+	void FilterVisibleCandidates(const FVector& Origin, const TArray<AActor*>& IgnoreActors, ECollisionChannel TraceChannel, TArray<FDamageableCandidate>& InOutCandidates) const;
+
+	// Width of a cell, in world units. Best at about the radius of a typical explosion.
+	UPROPERTY(EditAnywhere, Category = "Damage", meta = (ClampMin = "100"))
+		float CellSize;
+
+	// If true, radial damage also reaches damageable actors that don't register, at the cost of a physics overlap per explosion.
+	// Can be turned off in maps where every actor that reacts to damage registers.
+	UPROPERTY(EditAnywhere, Category = "Damage")
+		bool bDamageUnregisteredActors;
+
+	TArray<FDamageableEntry> Entries;
+
+	TMap<const USceneComponent*, int32> EntryIndices;
+
+	// Entry indices in each occupied cell.
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	// Largest bounds radius of any registered root, by which queries are widened to catch actors centred in a neighbouring cell.
+	float MaxBoundsRadius;
+};
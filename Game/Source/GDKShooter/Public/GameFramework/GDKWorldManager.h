@@ -0,0 +1,64 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Info.h"
+#include "GDKWorldManager.generated.h"
+
+/**
+ * AGDKWorldManager is the base for non-replicated, per-world systems shared by many actors,
+ * such as acceleration structures and schedulers. Each worker keeps its own instance.
+ * There is at most one manager of each type per world. It is spawned on first use, or can be
+ * placed in a level to override its defaults for that map.
+ * Get is not free, so callers should cache the manager rather than look it up every frame.
+ */
+UCLASS(Abstract)
+class GDKSHOOTER_API AGDKWorldManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AGDKWorldManager();
+
+	// Returns the manager of type T for the world of WorldContextObject, spawning it if there isn't one yet.
+	// Returns nullptr for worlds that are not game worlds or are being torn down.
+	template<class T>
+	static T* Get(const UObject* WorldContextObject)
+	{
+		UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+		if (World == nullptr || !World->IsGameWorld() || World->bIsTearingDown)
+		{
+			return nullptr;
+		}
+
+		if (T* Manager = Find<T>(WorldContextObject))
+		{
+			return Manager;
+		}
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		return World->SpawnActor<T>(SpawnParameters);
+	}
+
+	// Returns the manager of type T for the world of WorldContextObject, or nullptr if there isn't one.
+	template<class T>
+	static T* Find(const UObject* WorldContextObject)
+	{
+		UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+		if (World == nullptr)
+		{
+			return nullptr;
+		}
+
+		for (TActorIterator<T> It(World); It; ++It)
+		{
+			return *It;
+		}
+		return nullptr;
+	}
+};
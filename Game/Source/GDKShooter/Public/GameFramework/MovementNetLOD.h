@@ -0,0 +1,107 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "MovementNetLOD.generated.h"
+
+class ACharacter;
+
+// How a character's movement is replicated and smoothed when its nearest viewer is within MaxDistance.
+USTRUCT(BlueprintType)
+struct FMovementNetLODTier
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Ignored for the last tier, which covers everything further away.
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD")
+		float MaxDistance;
+
+	// [server] Caps the character's NetUpdateFrequency.
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD")
+		float MaxNetUpdateFrequency;
+
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD")
+		EVectorQuantization LocationQuantization;
+
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD")
+		EVectorQuantization VelocityQuantization;
+
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD")
+		ERotatorQuantization RotationQuantization;
+
+	// [client] Scales the time simulated proxies take to smooth out the difference to a new update, relative to
+	// the smoothing times their movement component's class defaults to.
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD", meta = (ClampMin = "0"))
+		float SmoothTimeScale;
+
+	// [client] Scales the distances beyond which updates are smoothed faster, and snapped to, relative to
+	// the distances their movement component's class defaults to.
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD", meta = (ClampMin = "0"))
+		float SmoothDistanceScale;
+
+	FMovementNetLODTier() :
+		MaxDistance(0.0f),
+		MaxNetUpdateFrequency(100.0f),
+		LocationQuantization(EVectorQuantization::RoundWholeNumber),
+		VelocityQuantization(EVectorQuantization::RoundWholeNumber),
+		RotationQuantization(ERotatorQuantization::ByteComponents),
+		SmoothTimeScale(1.0f),
+		SmoothDistanceScale(1.0f)
+	{}
+};
+
+/**
+ * AMovementNetLOD lowers the movement replication of characters that are far from anyone watching them.
+ * Servers pick each character's tier from the distance to the nearest other player's character, and cap its update
+ * rate and set its movement quantization to match. Clients pick a tier for each simulated proxy from its distance to
+ * the local viewpoint, and smooth coarse updates over longer, to cover the gaps between them.
+ * Place one in a map to tune the tiers for that map.
+ */
+UCLASS()
+class GDKSHOOTER_API AMovementNetLOD : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	AMovementNetLOD();
+
+	virtual void BeginPlay() override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	void Register(ACharacter* Character);
+	void Unregister(ACharacter* Character);
+
+private:
+
+	struct FLODEntry
+	{
+		TWeakObjectPtr<ACharacter> Character;
+		// Index in Tiers last applied to the character, or INDEX_NONE.
+		int32 Tier;
+	};
+
+	int32 GetTier(float Distance) const;
+
+	void UpdateServerTiers();
+	void UpdateClientTiers();
+
+	void ApplyServerTier(ACharacter* Character, const FMovementNetLODTier& Tier) const;
+	void ApplyClientTier(ACharacter* Character, const FMovementNetLODTier& Tier) const;
+
+	// From nearest to furthest.
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD")
+		TArray<FMovementNetLODTier> Tiers;
+
+	// Time between passes over the characters, in seconds.
+	UPROPERTY(EditAnywhere, Category = "Movement Net LOD", meta = (ClampMin = "0"))
+		float UpdateInterval;
+
+	TArray<FLODEntry> Entries;
+
+	// Locations of players' characters, gathered each server pass.
+	TArray<TPair<ACharacter*, FVector>> Viewers;
+};
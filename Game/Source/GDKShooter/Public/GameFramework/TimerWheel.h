@@ -0,0 +1,114 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "TimerWheel.generated.h"
+
+// Identifies a timer in an FGDKTimerWheel. Stays safe to cancel after the timer has fired.
+struct FTimerWheelHandle
+{
+	int32 Index;
+	uint32 Serial;
+
+	FTimerWheelHandle() :
+		Index(INDEX_NONE),
+		Serial(0)
+	{}
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	void Invalidate() { Index = INDEX_NONE; }
+};
+
+/**
+ * Hierarchical timer wheel, counting time in whole ticks. Each level has 64 slots, each slot covering 64 times as
+ * many ticks as a slot on the level below. Timers are kept in intrusive lists, so adding and cancelling are O(1).
+ * Advancing fires a whole slot at once, and timers on upper levels are moved down a level as their slot comes round.
+ */
+struct GDKSHOOTER_API FGDKTimerWheel
+{
+	FGDKTimerWheel();
+
+	// Calls Delegate once the wheel has advanced to ExpiryTick, or on the next tick if that has passed.
+	FTimerWheelHandle Add(uint64 ExpiryTick, const FSimpleDelegate& Delegate);
+
+	// Cancels the timer if it hasn't fired yet, and invalidates the handle.
+	void Cancel(FTimerWheelHandle& Handle);
+
+	// Advances to Tick, firing the timers that expire on the way.
+	void Advance(uint64 Tick);
+
+	uint64 GetCurrentTick() const { return CurrentTick; }
+	int32 Num() const { return NumTimers; }
+
+private:
+
+	static const int32 SlotBits = 6;
+	static const int32 NumSlots = 1 << SlotBits;
+	static const int32 NumLevels = 4;
+
+	struct FTimerNode
+	{
+		FSimpleDelegate Delegate;
+		uint64 ExpiryTick;
+		int32 Prev;
+		int32 Next;
+		// Level * NumSlots + slot of the list the node is in, or INDEX_NONE if the node is free.
+		int32 Bucket;
+		uint32 Serial;
+	};
+
+	// Puts the node in the slot its expiry falls in, relative to the current tick.
+	void Place(int32 NodeIndex);
+	void Link(int32 NodeIndex, int32 Bucket);
+	void Unlink(int32 NodeIndex);
+	void Free(int32 NodeIndex);
+
+	// Moves the timers in one slot of an upper level down, now that its slot has come round.
+	void Cascade(int32 Level);
+
+	TArray<FTimerNode> Nodes;
+	int32 BucketHeads[NumLevels * NumSlots];
+	int32 FreeHead;
+	int32 NumTimers;
+	uint64 CurrentTick;
+
+	// Scratch for the delegates fired in one tick.
+	TArray<FSimpleDelegate> Expired;
+};
+
+/**
+ * ATimerWheelManager runs a timer wheel on world time, for gameplay expirations such as projectile and ragdoll
+ * lifetimes. It ticks only while timers are pending, so actors with a lifetime don't need to tick or keep a
+ * timer manager timer each.
+ * Timers fire on the first frame after they expire, rounded up to the wheel's resolution.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API ATimerWheelManager : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	ATimerWheelManager();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// Calls Delegate after Delay seconds of world time.
+	FTimerWheelHandle SetTimer(float Delay, const FSimpleDelegate& Delegate);
+
+	// Cancels the timer if it hasn't fired yet, and invalidates the handle.
+	void ClearTimer(FTimerWheelHandle& Handle);
+
+	// Console command: times adding, cancelling and firing N timers.
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	uint64 GetTick(float WorldTime) const;
+
+	// Length of a tick of the wheel, in seconds.
+	static const float Resolution;
+
+	FGDKTimerWheel Wheel;
+};
@@ -0,0 +1,87 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/EngineTypes.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "HitscanManager.generated.h"
+
+// Axis-aligned bounds of four shapes, one per SIMD lane.
+MS_ALIGN(16) struct FHitscanBounds4
+{
+	VectorRegister MinX, MinY, MinZ;
+	VectorRegister MaxX, MaxY, MaxZ;
+} GCC_ALIGN(16);
+
+// Four hitbox capsules, one per SIMD lane: segment start A, segment vector BA, |BA|^2 and radius^2.
+MS_ALIGN(16) struct FHitscanPacket
+{
+	FHitscanBounds4 Bounds;
+	VectorRegister AX, AY, AZ;
+	VectorRegister BAX, BAY, BAZ;
+	VectorRegister BALengthSq;
+	VectorRegister RadiusSq;
+} GCC_ALIGN(16);
+
+/**
+ * AHitscanManager keeps simplified hitbox proxies (capsules) for characters, so hitscan shots can be tested
+ * against them without going through the physics scene. Only the rest of the world is traced in the physics scene,
+ * as occluders. It is spawned by the first shooting component that traces against proxies, and characters only
+ * register with it once it exists.
+ * Proxies are packed into a shallow BVH once per frame, on the first trace: capsules sorted along the widest
+ * axis, grouped into packets of four, and packets grouped into nodes of four. Rays are tested against four
+ * bounds or four capsules at a time with SIMD.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API AHitscanManager : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	AHitscanManager();
+
+	// Registers every character already in the world. Characters that begin play later register themselves.
+	virtual void BeginPlay() override;
+
+	void RegisterProxy(UCapsuleComponent* Capsule);
+	void UnregisterProxy(UCapsuleComponent* Capsule);
+
+	// Traces from Start to End against hitbox proxies, and against everything else that blocks TraceChannel as occluders.
+	// Actors ignored by Params are skipped. Fills OutHit in the same way as a physics line trace against the character's mesh.
+	bool LineTrace(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params);
+
+	// Console command: compares traces per second against the proxies with complex physics traces.
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	// Rebuilds the packed proxies from the current capsule transforms, at most once per frame.
+	void RebuildIfNeeded();
+
+	// Traces the proxies only. Returns the index of the closest proxy hit before MaxDistance, or INDEX_NONE.
+	int32 TraceProxies(const FVector& Start, const FVector& Direction, float MaxDistance, const FCollisionQueryParams& Params, float& OutDistance) const;
+
+	// Traces the physics scene for the closest hit that is not on a proxy's owner, which the proxies cover.
+	bool TraceOccluders(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params) const;
+
+	// Fills a hit on the proxy with the given index, Distance along the trace.
+	void MakeProxyHit(FHitResult& OutHit, int32 ProxyIndex, const FVector& Start, const FVector& End, float Distance, const FCollisionQueryParams& Params) const;
+
+	TArray<TWeakObjectPtr<UCapsuleComponent>> Proxies;
+
+	TArray<FHitscanPacket> Packets;
+
+	// Bounds of four packets per node.
+	TArray<FHitscanBounds4> Nodes;
+
+	// Proxy index for each lane of each packet, INDEX_NONE for padding.
+	TArray<int32> PacketLaneProxies;
+
+	// Unique id of each proxy's owner at build time, for ignoring actors without dereferencing them.
+	TArray<uint32> ProxyActorIds;
+
+	uint64 BuiltFrame;
+};
@@ -3,14 +3,138 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Characters/Components/HitboxHistoryComponent.h"
 #include "Weapons/Weapon.h"
+#include "Engine/NetSerialization.h"
 #include "Runtime/Engine/Public/TimerManager.h"
 #include "InstantWeapon.generated.h"
 
+class AInstantWeapon;
+
+// A validated shot, as replicated to other clients for visualization.
+USTRUCT()
+struct FShotVisualization : public FFastArraySerializerItem
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		FInstantHitInfo HitInfo;
+
+	// Server time at which the shot was validated.
+	UPROPERTY()
+		float ServerTime;
+
+	FShotVisualization() :
+		ServerTime(0.0f)
+	{}
+
+	void PostReplicatedAdd(const struct FShotVisualizationRing& InArraySerializer);
+	void PostReplicatedChange(const struct FShotVisualizationRing& InArraySerializer);
+};
+
+// A reported hit whose aim the server has not yet received the owner's view for.
+USTRUCT()
+struct FAwaitingHit
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		FInstantHitInfo HitInfo;
+
+	// Server time after which the hit is rejected if its aim is still not covered.
+	UPROPERTY()
+		float Deadline;
+
+	FAwaitingHit() :
+		Deadline(0.0f)
+	{}
+};
+
+// Fixed-size ring of a weapon's most recent shots. Full slots are overwritten in place, so only changed slots are sent.
+USTRUCT()
+struct FShotVisualizationRing : public FFastArraySerializer
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		TArray<FShotVisualization> Items;
+
+	// Weapon that owns the ring, bound in AInstantWeapon::PostInitializeComponents.
+	UPROPERTY(NotReplicated, Transient)
+		AInstantWeapon* Weapon;
+
+	FShotVisualizationRing() :
+		Weapon(nullptr),
+		NextSlot(0)
+	{}
+
+	// [server] Writes a shot into the next slot, overwriting the oldest once the ring holds Capacity shots.
+	void AddShot(const FInstantHitInfo& HitInfo, float ServerTime, int32 Capacity);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FShotVisualization, FShotVisualizationRing>(Items, DeltaParms, *this);
+	}
+
+private:
+
+	int32 NextSlot;
+};
+
+template<>
+struct TStructOpsTypeTraits<FShotVisualizationRing> : public TStructOpsTypeTraitsBase2<FShotVisualizationRing>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
+
+// Token bucket limiting the rate of shots a client can report. Holds up to Capacity shots and refills at RefillRate shots per second.
+struct FShotTokenBucket
+{
+	float Tokens;
+	float Capacity;
+	float RefillRate;
+	float LastRefillTime;
+
+	FShotTokenBucket() :
+		Tokens(0.0f),
+		Capacity(0.0f),
+		RefillRate(0.0f),
+		LastRefillTime(0.0f)
+	{}
+
+	// Sets the limits and fills the bucket.
+	void Configure(float InCapacity, float InRefillRate, float Now)
+	{
+		Capacity = InCapacity;
+		RefillRate = InRefillRate;
+		Tokens = InCapacity;
+		LastRefillTime = Now;
+	}
+
+	// Takes a token for one shot. Returns false if the bucket is empty.
+	bool TryConsume(float Now)
+	{
+		Tokens = FMath::Min(Capacity, Tokens + (Now - LastRefillTime) * RefillRate);
+		LastRefillTime = Now;
+		if (Tokens < 1.0f)
+		{
+			return false;
+		}
+		Tokens -= 1.0f;
+		return true;
+	}
+};
+
 /**
  * AInstantWeapon implements hitscan shooting for a single-shot, burst-fire, or full-auto weapon.
- * Hit detection is entirely client-side, with loose server validation.
- * Shot timing and rate-limiting is entirely client-side, with no server validation.
+ * Hit detection is client-side, validated on the server against the target's hitbox at the time the shot was fired.
+ * Spread is generated from a seed shared with the owning client, so the server can recompute each shot's direction
+ * from its index and check that the hit lies along it.
+ * Shot timing is client-side. The server caps the rate of reported shots with a token bucket derived from the weapon's
+ * fire rate, and drops shots over the cap before validating them.
  */
 UCLASS(Abstract, Blueprintable, SpatialType)
 class GDKSHOOTER_API AInstantWeapon : public AWeapon
@@ -23,13 +147,19 @@ public:
 	virtual void StartPrimaryUse_Implementation() override;
 	virtual void StopPrimaryUse_Implementation() override;
 
-	// RPC for telling the server that we fired and hit something.
+	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual void SetOwner(AActor* NewOwner) override;
+
+	// RPC for telling the server about a batch of shots, at least one of which hit something.
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerDidHit(const FInstantHitInfo& HitInfo);
+	void ServerReportShots(const TArray<FInstantHitInfo>& Shots);
 
-	// RPC for telling the server that we fired and did not hit anything.
+	// RPC for telling the server about a batch of shots, none of which hit anything.
 	UFUNCTION(Server, Unreliable, WithValidation)
-	void ServerDidMiss(const FInstantHitInfo& HitInfo);
+	void ServerReportMisses(const TArray<FInstantHitInfo>& Shots);
 
 	UFUNCTION(BlueprintImplementableEvent, Category = "Weapons")
 	void OnRenderShot(const FVector Location, bool bImpact);
@@ -37,25 +167,71 @@ public:
 	UFUNCTION(BlueprintImplementableEvent)
 		void FinishedBurst();
 
+	// [client] Visualizes a shot replicated from the server, unless it is older than ShotVisualizationDelayTolerance.
+	void PlayShotVisualization(const FShotVisualization& Shot);
+
 	virtual void SetIsActive(bool bNewActive) override;
 
 protected:
 
-	// [client] Runs a line trace and triggers the server RPC for hits.
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// [client] Runs a line trace per pellet, synchronously or async, and queues the results for the server.
 	virtual void DoFire_Implementation() override;
 
 	virtual FVector GetLineTraceDirection() override;
 
 private:
 
-	// [server] Notifies clients of a hit.
-	void NotifyClientsOfHit(const FInstantHitInfo& HitInfo, bool bImpact);
+	// [client] Renders and reports the results of one shot's traces, one per pellet.
+	void HandleShotResults(const TArray<FInstantHitInfo>& Results, float FireTime, int32 FirstShotIndex);
+
+	// Spread at 100m for the owner's current stance.
+	float GetSpreadAt100m();
+
+	// Spread at 100m for the given stance.
+	float GetSpreadAt100m(bool bAiming, bool bCrouching) const;
+
+	// Offset of the shot with the given index from the aim direction, at 100m. The same on the owning client and the server.
+	FVector2D GetSpreadOffset(int32 ShotIndex, float Spread) const;
+
+	// [server] Checks that the hit lies along the direction the shot's spread index gives, from an aim the owner swept through
+	// between the time it fired and now, with the spread of its stance at the time. Only shots reported by a remote player
+	// are checked. Sets bOutAwaitingView if the aim may still be covered by views that have not arrived yet.
+	bool ValidateShotDirection(const FInstantHitInfo& HitInfo, bool& bOutAwaitingView);
+
+	// [client] Adds a shot to the pending report, sending the report if it is full, or at the end of the frame otherwise.
+	void QueueShotReport(const FInstantHitInfo& HitInfo);
+
+	// [client] Sends all pending shots to the server in a single RPC.
+	void FlushShotReports();
+
+	// [server] Validates and applies a batch of shots reported by the client, then notifies other clients.
+	void ProcessShots(const TArray<FInstantHitInfo>& Shots);
+
+	// [server] Sets up the fire-rate token bucket from ShotInterval, BurstInterval, BurstCount and PelletsPerShot.
+	void ConfigureShotTokenBucket();
+
+	// [server] Notifies clients of a batch of shots, by adding them to the replicated ring of recent shots.
+	void NotifyClientsOfShots(const TArray<FInstantHitInfo>& Shots);
 
 	// [client] Spawns the hit FX in the world.
 	void SpawnFX(const FInstantHitInfo& HitInfo, bool bImpact);
 
 	// [server] Validates the hit. Returns true if it's valid, false otherwise.
-	bool ValidateHit(const FInstantHitInfo& HitInfo);
+	// Sets bOutAwaitingView if the hit failed only because the owner's view at the time has not arrived yet.
+	bool ValidateHit(const FInstantHitInfo& HitInfo, bool& bOutAwaitingView);
+
+	// [server] Validates the hit, applying it if valid, or queues it if the owner's view at the time has not arrived yet.
+	// Returns true if the hit was applied.
+	bool ProcessHit(const FInstantHitInfo& HitInfo, float Deadline);
+
+	// [server] Revalidates the hits waiting for the owner's views, in order, until one is still waiting.
+	void ProcessAwaitingHits();
+
+	// [server] Clamps a client-reported fire time to how far back the owner's latency allows: its round trip plus FireTimeTolerance,
+	// but no further back than History reaches.
+	float ClampFireTime(float FireTime, const UHitboxHistoryComponent* History) const;
 
 	// [server] Actually deals damage to the actor we hit.
 	void DealDamage(const FInstantHitInfo& HitInfo);
@@ -63,10 +239,6 @@ private:
 	// [client] Clears the NextShotTimer if it's running.
 	void ClearTimerIfRunning();
 
-	// Notifies all clients that a shot hit something. Used for visualizing shots on the client.
-	UFUNCTION(NetMulticast, Unreliable)
-	void MulticastNotifyHit(FInstantHitInfo HitInfo, bool bImpact);
-
 	// Returns true if the weapon is a burst-fire weapon.
 	FORCEINLINE bool IsBurstFire()
 	{
@@ -116,10 +288,43 @@ private:
 	UPROPERTY(EditAnywhere, Category = "Weapons")
 	TSubclassOf<UDamageType> DamageTypeClass;
 
+	// Number of line traces per shot, each with its own spread.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "1", ClampMax = "256"))
+		int32 PelletsPerShot;
+
+	// If true, a shot's traces are submitted with the async trace API and handled when the results arrive, usually next frame.
+	UPROPERTY(EditAnywhere, Category = "Weapons")
+		bool bUseAsyncTraces;
+
+	// If true, shots fired during a frame are reported to the server together in one RPC at the end of the frame.
+	// Otherwise every shot is reported immediately.
+	UPROPERTY(EditAnywhere, Category = "Weapons")
+		bool bBatchShotReports;
+
+	// Maximum number of shots sent in a single report. A full report is sent immediately, and the server ignores the
+	// shots of a report beyond this.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "1"))
+		int32 MaxShotsPerReport;
+
+	// [client] Shots fired since the last report to the server.
+	TArray<FInstantHitInfo> PendingShots;
+
+	// [client] True if any pending shot hit something, in which case the report is sent reliably.
+	bool bPendingShotsHaveHit;
+
 	// Tolerance, in seconds, after which we will no longer visualize a shot notification.
 	UPROPERTY(EditAnywhere, Category = "Weapons")
 		FTimespan ShotVisualizationDelayTolerance;
 
+	// Number of recent shots replicated for visualization. Shots fired faster than the weapon's net update rate
+	// beyond this are not visualized.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "1"))
+		int32 ShotVisualizationCapacity;
+
+	// Recent validated shots, replicated to every client the weapon is relevant to except its owner.
+	UPROPERTY(Replicated)
+		FShotVisualizationRing RecentShots;
+
 	UPROPERTY(EditAnywhere, Category = "Weapons")
 		float SpreadAt100m = 0;
 
@@ -128,4 +333,54 @@ private:
 
 	UPROPERTY(EditAnywhere, Category = "Weapons")
 		float SpreadCrouchModifier = 0.5f;
+
+	// Maximum angle, in degrees, between the aim implied by a reported hit and the aims the server recorded for the owner
+	// since the shot. Covers the quantization of the owner's control rotation.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "0"))
+		float MaxAimDeviation = 0.25f;
+
+	// Maximum distance, in world units, between where the owner shot from and where the server had it shooting from.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "0"))
+		float MaxViewLocationDeviation = 10.0f;
+
+	// Time, in seconds, on top of the owner's round trip, that a reported shot may claim to have been fired in the past.
+	// Covers jitter and the client's estimate of server time.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "0"))
+		float FireTimeTolerance = 0.1f;
+
+	// Seed of the spread sequence. Chosen by the server for each new owner and replicated to the owner only.
+	UPROPERTY(ReplicatedUsing = OnRep_SpreadSeed)
+		int32 SpreadSeed;
+
+	UFUNCTION()
+		void OnRep_SpreadSeed();
+
+	// [client] Index of the next shot in the spread sequence.
+	int32 NextShotIndex;
+
+	// [server] Highest shot index that has been validated. Hits must arrive with increasing indices.
+	int32 LastValidatedShotIndex;
+
+	// Time, in seconds, that the server waits for the owner's view at the time of a hit. The owner's views arrive with its
+	// moves, which are unreliable and sent separately from its shot reports, so a shot can arrive before the aim it was fired with.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "0"))
+		float ViewArrivalTolerance = 0.15f;
+
+	// [server] Hits waiting for the owner's view, oldest first. Later hits queue behind them, to keep them in order.
+	UPROPERTY(Transient)
+		TArray<FAwaitingHit> AwaitingHits;
+
+	// [server] Views of the owner around a shot being validated, reused between shots.
+	TArray<FViewSnapshot> ViewBuffer;
+
+	// Time, in seconds, of firing at the maximum rate that the server lets a client report in one go,
+	// on top of a full burst. Covers network jitter bunching reports together.
+	UPROPERTY(EditAnywhere, Category = "Weapons")
+		float FireRateTolerance = 0.5f;
+
+	// [server] Limits the rate of shots reported by the owner.
+	FShotTokenBucket ShotTokenBucket;
+
+	// [server] Number of reported shots dropped for exceeding the fire rate.
+	int32 DroppedShotCount;
 };
@@ -6,9 +6,58 @@
 #include "GameFramework/Actor.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "Engine/NetSerialization.h"
+#include "GameFramework/TimerWheel.h"
 #include "Weapons/Weapon.h"
 #include "Projectile.generated.h"
 
+class ADamageableGrid;
+class AProjectilePool;
+struct FSimulatedProjectileClass;
+
+// A projectile's position and velocity at its launch, last bounce, stop or explosion.
+// Between events the path is ballistic, so clients extrapolate it from the latest event.
+USTRUCT()
+struct FProjectileFlightEvent
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		FVector_NetQuantize Location;
+
+	UPROPERTY()
+		FVector_NetQuantize Velocity;
+
+	// Server time at which the event happened.
+	UPROPERTY()
+		float ServerTime;
+
+	FProjectileFlightEvent() :
+		Location(ForceInitToZero),
+		Velocity(ForceInitToZero),
+		ServerTime(0.0f)
+	{}
+};
+
+// Links an authoritative projectile to the cosmetic one its owning client predicted when firing.
+USTRUCT()
+struct FProjectilePrediction
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		AWeapon* Weapon;
+
+	// INDEX_NONE if the client didn't predict the projectile.
+	UPROPERTY()
+		int32 Id;
+
+	FProjectilePrediction() :
+		Weapon(nullptr),
+		Id(INDEX_NONE)
+	{}
+};
+
 UCLASS(Abstract, Blueprintable)
 class GDKSHOOTER_API AProjectile : public AActor
 {
@@ -19,7 +68,13 @@ public:
 
 	virtual void PostInitializeComponents() override;
 
-	virtual void Tick(float DeltaTime) override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void OnAuthorityGained() override;
+	virtual void OnAuthorityLost() override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
@@ -34,10 +89,80 @@ public:
 	UPROPERTY(Handover)
 		AWeapon* InstigatingWeapon;
 
+	// [server] This server's pool, that the projectile returns to once it is done, or nullptr if it is destroyed instead.
+	// Each server has its own pool, so it is looked up again by a server that gains authority over a pooled projectile.
+	UPROPERTY()
+		AProjectilePool* OwningPool;
+
+	// True if the projectile returns to a pool once it is done, on whichever server has authority over it.
+	UPROPERTY(Handover)
+		bool bPooled;
+
+	// True while a pooled projectile is parked in its pool.
+	UPROPERTY(Handover)
+		bool bIdle;
+
+	// [server] Resets a pooled projectile's state so it can be launched again from its current transform.
+	void ResetForLaunch();
+
+	// [server] Parks a pooled projectile: hidden, without collision, movement or timers.
+	void Deactivate();
+
+	// [server] Makes a pooled projectile spawn parked, so it never collides or starts its lifetime.
+	// Must be called before the projectile finishes spawning.
+	void MakeIdle();
+
+	// [client] Makes a projectile spawned locally cosmetic: it isn't replicated, deals no damage and vanishes when it explodes.
+	// Must be called before the projectile finishes spawning.
+	void MakeCosmetic();
+
+	// [client] Makes a projectile spawned locally just the explosion of a projectile simulated without an actor:
+	// it plays ExplosionVisuals where it spawns, and is destroyed after LingerAfterExplode.
+	// Must be called before the projectile finishes spawning.
+	void MakeCosmeticExplosion();
+
+	// [server] Advances a newly launched projectile by Seconds, in sweeps of at most MaxStepTime, to catch up on the
+	// latency of the shot that fired it.
+	void FastForward(float Seconds, float MaxStepTime);
+
+	// [server] Sets which of its owner's predicted projectiles this one replaces.
+	void SetPrediction(AWeapon* Weapon, int32 PredictionId);
+
+	// Fills in the parameters AProjectileSimulation needs to simulate projectiles of this class without an actor.
+	void GetSimulatedClass(FSimulatedProjectileClass& OutClass) const;
+
 protected:
 
 	virtual void PostNetReceiveVelocity(const FVector& NewVelocity) override;
 
+	// If true, only the launch, bounces, stop and explosion are replicated, and clients extrapolate the flight in between.
+	// If false, movement is replicated continuously, which projectiles that Blueprints attach or move in flight need.
+	UPROPERTY(EditDefaultsOnly, Category = Projectile)
+		bool bReplicateFlightEvents = false;
+
+	// Most recent flight event, when bReplicateFlightEvents is set.
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_FlightEvent)
+		FProjectileFlightEvent FlightEvent;
+
+	UFUNCTION()
+		void OnRep_FlightEvent();
+
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_Prediction)
+		FProjectilePrediction Prediction;
+
+	UFUNCTION()
+		void OnRep_Prediction();
+
+	bool bCosmetic = false;
+
+	bool bCosmeticExplosion = false;
+
+	// [server] Records the current location and velocity as the latest flight event.
+	void RecordFlightEvent();
+
+	// Current server time, as best known locally.
+	float GetServerWorldTimeSeconds() const;
+
 	UFUNCTION()
 		virtual void OnStop(const FHitResult& ImpactResult);
 	UFUNCTION()
@@ -71,7 +196,23 @@ protected:
 
 	int BouncesSoFar = 0;
 
-	float BeginTime;
+	// [server] Explodes the projectile after Delay seconds, replacing any earlier schedule.
+	void ScheduleExplosion(float Delay);
+
+	void OnLifetimeExpired();
+
+	// [server] Wheel that the lifetime and linger timers run on.
+	UPROPERTY()
+		ATimerWheelManager* TimerWheel;
+
+	FTimerWheelHandle LifetimeHandle;
+
+	// [server] World time at which the lifetime or, once exploded, the linger runs out on this server.
+	float TimerExpiryTime;
+
+	// Time left on the lifetime or, once exploded, the linger. Kept up to date for the server that takes over the projectile.
+	UPROPERTY(Handover)
+		float TimerRemaining;
 
 	UFUNCTION()
 		void OnRep_MetaData();
@@ -88,9 +229,25 @@ protected:
 	UFUNCTION(BlueprintNativeEvent)
 		void ExplosionVisuals();
 
+	// Undoes ExplosionVisuals when a pooled projectile is launched again.
+	UFUNCTION(BlueprintNativeEvent)
+		void ResetVisuals();
+
+	// Time, in seconds, that the projectile is kept after exploding, for the explosion to replicate and play out.
+	UPROPERTY(EditDefaultsOnly, Category = Projectile)
+		float LingerAfterExplode = 2.0f;
+
+	FTimerWheelHandle ReleaseHandle;
+
+	void ReturnToPool();
+
 	UPROPERTY(Handover)
 		AController* InstigatingController;
 
+	// [server] Grid of damageable actors that explosions look up their victims in.
+	UPROPERTY()
+		ADamageableGrid* DamageableGrid;
+
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = Projectile)
 		float ExplosionDamage = 50;
 
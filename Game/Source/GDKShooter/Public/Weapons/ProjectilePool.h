@@ -0,0 +1,75 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "Weapons/Holdable.h"
+#include "ProjectilePool.generated.h"
+
+class AProjectile;
+class AWeapon;
+
+// Idle projectiles of one class, and how the pool has served that class.
+USTRUCT()
+struct FProjectilePoolBucket
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		TArray<AProjectile*> Free;
+
+	// Launches served by an idle projectile.
+	int32 Hits;
+	// Launches that had to spawn a new projectile.
+	int32 Misses;
+	int32 InUse;
+	// Most projectiles of this class in use at once.
+	int32 HighWater;
+
+	FProjectilePoolBucket() :
+		Hits(0),
+		Misses(0),
+		InUse(0),
+		HighWater(0)
+	{}
+};
+
+/**
+ * AProjectilePool keeps exploded projectiles on the server and launches them again, instead of spawning and
+ * destroying an actor for every shot. Idle projectiles are hidden, with collision, movement and ticking disabled.
+ * Each server has its own pool. Pooled projectiles move to the pool of the server that gains authority over them.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API AProjectilePool : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	// [server] Spawns idle projectiles of the class until at least Count exist.
+	void Prewarm(TSubclassOf<AProjectile> ProjectileClass, int32 Count);
+
+	// [server] Launches a projectile of the class from the transform, for the weapon, reusing an idle one if there is one.
+	AProjectile* Launch(TSubclassOf<AProjectile> ProjectileClass, const FTransform& Transform, AWeapon* Weapon, const FGDKMetaData& MetaData);
+
+	// [server] Returns a projectile that is done to the pool.
+	void Release(AProjectile* Projectile);
+
+	// [server] Takes over a pooled projectile that this server gained authority over from another.
+	void Adopt(AProjectile* Projectile);
+
+	// [server] Stops tracking a pooled projectile that another server took authority over.
+	void Forget(AProjectile* Projectile);
+
+	// Console command: logs hits, misses and high-water marks for each projectile class.
+	static void LogStats(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	// Spawns a pooled projectile, launched or, if bIdle, parked from the start.
+	AProjectile* SpawnProjectile(UClass* ProjectileClass, const FTransform& Transform, AWeapon* Weapon, const FGDKMetaData& MetaData, bool bIdle = false);
+
+	UPROPERTY()
+		TMap<UClass*, FProjectilePoolBucket> Buckets;
+};
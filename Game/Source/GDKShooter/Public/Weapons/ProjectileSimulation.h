@@ -0,0 +1,145 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/EngineTypes.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "ProjectileSimulation.generated.h"
+
+class ADamageableGrid;
+class AProjectile;
+class AProjectileWeapon;
+
+// Parameters shared by all simulated projectiles of one AProjectile class, read from its defaults.
+USTRUCT()
+struct FSimulatedProjectileClass
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		UClass* ProjectileClass;
+
+	UPROPERTY()
+		UStaticMesh* Mesh;
+
+	UPROPERTY()
+		TArray<UMaterialInterface*> Materials;
+
+	// [client] One instance per live projectile of this class.
+	UPROPERTY()
+		UInstancedStaticMeshComponent* Instances;
+
+	UPROPERTY()
+		TSubclassOf<UDamageType> DamageTypeClass;
+
+	FTransform MeshTransform;
+
+	TEnumAsByte<ECollisionChannel> CollisionChannel;
+	FCollisionResponseContainer CollisionResponses;
+	float Radius;
+
+	float InitialSpeed;
+	float GravityScale;
+	bool bShouldBounce;
+	float Bounciness;
+	float Friction;
+	// Projectiles stop after a bounce that leaves them slower than this.
+	float StopSpeed;
+
+	bool bExplodeOnStop;
+	int32 MaximumBounces;
+	float LifeTillExplode;
+
+	float ExplosionDamage;
+	float ExplosionMinimumDamage;
+	float ExplosionRadius;
+	float ExplosionInnerRadius;
+	float ExplosionFalloff;
+
+	FSimulatedProjectileClass() :
+		ProjectileClass(nullptr),
+		Mesh(nullptr),
+		Instances(nullptr)
+	{}
+};
+
+/**
+ * AProjectileSimulation simulates projectiles without actors, as an alternative to spawning an AProjectile per shot.
+ * Projectiles are stored as structure of arrays and integrated four at a time with SIMD, then swept against the world
+ * in one pass. Integration is exact for constant gravity, so the server and clients follow the same path between
+ * impacts regardless of frame rate.
+ * Only spawns and explosions are sent over the network, by the firing AProjectileWeapon. The server applies damage;
+ * clients simulate the same projectiles for visuals, drawn with one instanced mesh per projectile class.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API AProjectileSimulation : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	AProjectileSimulation();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// Adds a projectile of the class, launched from Origin along Direction and already FastForward seconds into its flight.
+	// Projectiles without a weapon are cosmetic and deal no damage. Returns the projectile's id.
+	// Pass INDEX_NONE to allocate an id, or the id the server sent. Ids allocated on clients are negative.
+	int32 SpawnProjectile(TSubclassOf<AProjectile> ProjectileClass, const FVector& Origin, const FVector& Direction, AProjectileWeapon* Weapon, int32 Id, float FastForward);
+
+	// Removes the projectile with the id, if it is still live. Returns its location.
+	bool RemoveProjectile(int32 Id, FVector& OutLocation);
+
+	int32 GetNumProjectiles() const { return Ids.Num(); }
+
+	// Console command: times the simulation with N cosmetic projectiles (1000 by default).
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	// Advances all projectiles by DeltaTime.
+	void Simulate(float DeltaTime);
+
+	// [client] Moves each class's instances to its projectiles.
+	void UpdateVisuals();
+
+	// Ends the projectile at Index: damage and explosion event on the server, removal everywhere.
+	void Explode(int32 Index);
+
+	void RemoveAt(int32 Index);
+
+	int32 FindOrAddClass(UClass* ProjectileClass);
+
+	typedef TArray<float, TAlignedHeapAllocator<16>> FFloatLanes;
+
+	FFloatLanes PositionX, PositionY, PositionZ;
+	FFloatLanes VelocityX, VelocityY, VelocityZ;
+	// Gravity acceleration along Z, with the class's gravity scale applied. 0 for projectiles at rest.
+	FFloatLanes GravityZ;
+	FFloatLanes PreviousX, PreviousY, PreviousZ;
+
+	TArray<float> ExplodeTimes;
+	TArray<int32> Bounces;
+	TArray<int32> ClassIndices;
+	TArray<int32> Ids;
+	TArray<uint8> bResting;
+	TArray<TWeakObjectPtr<AProjectileWeapon>> Weapons;
+	// Actor the projectile doesn't collide with, usually the character that fired it.
+	TArray<TWeakObjectPtr<AActor>> IgnoredActors;
+
+	TMap<int32, int32> IdToIndex;
+
+	UPROPERTY()
+		TArray<FSimulatedProjectileClass> Classes;
+
+	// [client] Scratch instance transforms for each class.
+	TArray<TArray<FTransform>> ClassTransforms;
+
+	int32 NextId;
+
+	// [server] Grid of damageable actors that explosions look up their victims in.
+	UPROPERTY()
+		ADamageableGrid* DamageableGrid;
+};
@@ -6,6 +6,21 @@
 #include "Weapons/Weapon.h"
 #include "ProjectileWeapon.generated.h"
 
+class AProjectile;
+class AProjectilePool;
+class AProjectileSimulation;
+
+UENUM(BlueprintType)
+enum class EProjectileBackend : uint8
+{
+	// Spawn a new actor for every projectile and destroy it after it explodes.
+	Actor			UMETA(DisplayName = "Actor"),
+	// Reuse exploded projectile actors from the world's projectile pool.
+	PooledActor		UMETA(DisplayName = "Pooled Actor"),
+	// Simulate projectiles without actors in the world's projectile simulation. Only spawns and explosions are replicated.
+	Simulated		UMETA(DisplayName = "Simulated"),
+};
+
 /**
  * 
  */
@@ -16,9 +31,29 @@ class GDKSHOOTER_API AProjectileWeapon : public AWeapon
 
 public:
 	AProjectileWeapon();
+
+	virtual void BeginPlay() override;
+
+	// Tells clients to simulate a projectile the server spawned in the projectile simulation.
+	// The owning client replaces the projectile it predicted for the shot, if any.
+	// Reliable, since a projectile that clients never see can still kill them.
+	UFUNCTION(NetMulticast, Reliable)
+		void MulticastSimulatedProjectileSpawned(int32 ProjectileId, FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float SpawnServerTime, int32 PredictionId);
+
+	// Tells clients that a simulated projectile exploded, so they remove it and play the explosion.
+	// Reliable, so that the projectile doesn't fly on forever and the explosion always plays.
+	UFUNCTION(NetMulticast, Reliable)
+		void MulticastSimulatedProjectileExploded(int32 ProjectileId, FVector_NetQuantize Location);
+
+	// [client] Removes the cosmetic projectile predicted for a shot, now that the authoritative one has arrived.
+	void ReconcilePredictedProjectile(int32 PredictionId);
 	
 protected:
 
+	// [client] Called when a simulated projectile explodes, after the projectile class's ExplosionVisuals have started playing.
+	UFUNCTION(BlueprintImplementableEvent, Category = "Weapons")
+		void OnSimulatedProjectileExploded(FVector Location);
+
 	virtual void DoFire_Implementation() override;
 
 	UFUNCTION(BlueprintImplementableEvent, Category = "Weapons")
@@ -35,12 +70,58 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapons")
 		TSubclassOf<class AProjectile> ProjectileClass;
 
+	// How projectiles are created on the server.
+	UPROPERTY(EditAnywhere, Category = "Weapons")
+		EProjectileBackend ProjectileBackend = EProjectileBackend::Actor;
+
+	// Number of projectiles of ProjectileClass to create up front when pooling.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "0"))
+		int32 ProjectilePoolPrewarmCount = 4;
+
+	// Maximum time, in seconds, that the server fast-forwards a new projectile by to make up for the shooter's latency.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "0"))
+		float MaxProjectileCatchUp = 0.2f;
+
+	// Longest single sweep, in seconds, when fast-forwarding a new projectile.
+	UPROPERTY(EditAnywhere, Category = "Weapons", meta = (ClampMin = "0.001"))
+		float ProjectileCatchUpStepTime = 0.02f;
+
+	// If true, the shooting client shows a cosmetic projectile straight away, replaced when the server's arrives.
+	UPROPERTY(EditAnywhere, Category = "Weapons")
+		bool bPredictProjectiles = true;
+
 	// Socket name of where to spawn projectiles
 	UPROPERTY(EditAnywhere, Category = "Weapons")
 		FName BarrelSocket = FName(TEXT("WP_Barrel"));
 
 	UFUNCTION(reliable, server, WithValidation)
-		void FireProjectile(FVector Origin, FVector_NetQuantizeNormal Direction);
+		void FireProjectile(FVector Origin, FVector_NetQuantizeNormal Direction, int32 PredictionId);
 
 	virtual void ConsumeBufferedShot() override;
+
+private:
+
+	// [server] Time to fast-forward a new projectile by: half the owner's measured round trip, capped by MaxProjectileCatchUp.
+	float GetProjectileCatchUpTime() const;
+
+	// [client] Plays the projectile class's ExplosionVisuals for a simulated projectile that exploded at Location.
+	void PlaySimulatedExplosion(const FVector& Location);
+
+	// [client] Spawns a cosmetic projectile for a shot. Returns the prediction id to send with the shot, or INDEX_NONE.
+	int32 PredictProjectile(const FVector& Origin, const FVector& Direction);
+
+	// [client] Id of the next predicted projectile.
+	int32 NextPredictionId;
+
+	// [client] Cosmetic projectiles waiting for their authoritative projectile, by prediction id.
+	TMap<int32, TWeakObjectPtr<AProjectile>> PredictedProjectiles;
+
+	// [client] Ids of predicted projectiles in the projectile simulation, by prediction id.
+	TMap<int32, int32> PredictedSimulatedProjectiles;
+
+	UPROPERTY()
+		AProjectilePool* ProjectilePool;
+
+	UPROPERTY()
+		AProjectileSimulation* ProjectileSimulation;
 };
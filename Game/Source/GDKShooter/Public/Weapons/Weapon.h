@@ -12,6 +12,8 @@
 #include "TimerManager.h"
 #include "Weapon.generated.h"
 
+class AWeaponFiringScheduler;
+
 UCLASS(Abstract)
 class GDKSHOOTER_API AWeapon : public AHoldable
 {
@@ -20,7 +22,11 @@ class GDKSHOOTER_API AWeapon : public AHoldable
 public:	
 	AWeapon();
 
-	virtual void Tick(float DeltaTime) override;
+	virtual void BeginPlay() override;
+
+	// Fires if the trigger is held or a shot is buffered and the weapon is ready, and expires stale buffered shots.
+	// Called every frame by the firing scheduler. Returns false once the weapon is idle and needs no more updates.
+	bool UpdateFiring();
 
 	virtual void StartSecondaryUse_Implementation() override;
 	virtual void StopSecondaryUse_Implementation() override;
@@ -90,6 +96,9 @@ protected:
 	UFUNCTION(BlueprintPure)
 		FInstantHitInfo DoLineTrace();
 
+	// Current server time, as best known locally. Shots are stamped with this so the server can rewind hit actors.
+	float GetServerWorldTimeSeconds() const;
+
 	// Time that we are next able to shoot
 	float NextShotTime;
 	// Buffered shots are for when e.g. people double click just slightly faster than the RoF
@@ -101,6 +110,9 @@ protected:
 	bool BufferedShotStillValid();
 	virtual void ConsumeBufferedShot();
 
+	// True if the weapon's Blueprint implements Event Tick, in which case the weapon ticks for its whole life.
+	bool bTicksInBlueprint;
+
 private:
 
 	UPROPERTY()
@@ -109,6 +121,8 @@ private:
 		UGDKMovementComponent* CachedMovementComponent;
 	UPROPERTY()
 		UShootingComponent* CachedShootingComponent;
+	UPROPERTY()
+		AWeaponFiringScheduler* FiringScheduler;
 	UFUNCTION()
 		void RefreshComponentCache();
 	
@@ -0,0 +1,32 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GDKWorldManager.h"
+#include "WeaponFiringScheduler.generated.h"
+
+class AWeapon;
+
+/**
+ * AWeaponFiringScheduler drives firing for the weapons that are being fired or have a buffered shot, so that
+ * weapons don't need to tick. Weapons schedule themselves when their trigger is pulled and are dropped once
+ * they are idle again. The scheduler stops ticking while no weapon is scheduled.
+ */
+UCLASS(NotPlaceable)
+class GDKSHOOTER_API AWeaponFiringScheduler : public AGDKWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	AWeaponFiringScheduler();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// Updates the weapon every frame until it is idle.
+	void Schedule(AWeapon* Weapon);
+
+private:
+
+	TArray<TWeakObjectPtr<AWeapon>> ScheduledWeapons;
+};